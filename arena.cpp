@@ -0,0 +1,52 @@
+#include "arena.h"
+
+#include <cstdint>
+
+using namespace std;
+
+Arena::Arena(size_t blockSize) : _blockSize(blockSize), _block(0), _used(0) {
+	_blocks.push_back(make_unique<char[]>(_blockSize));
+	_sizes.push_back(_blockSize);
+}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+	for (;;) {
+		uintptr_t base = (uintptr_t)_blocks[_block].get();
+		size_t offset = ((base + _used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+
+		if (offset + bytes <= _sizes[_block]) {
+			_used = offset + bytes;
+			return (void*)(base + offset);
+		}
+
+		// the rest of this block is wasted until the next reset or rewind
+		_block++;
+		_used = 0;
+
+		if (_block == _blocks.size() || _sizes[_block] < bytes + alignment) {
+			size_t size = max(_blockSize, bytes + alignment);
+
+			_blocks.insert(_blocks.begin() + _block, make_unique<char[]>(size));
+			_sizes.insert(_sizes.begin() + _block, size);
+		}
+	}
+}
+
+void Arena::rewind(const Mark& mark) {
+	_block = mark.block;
+	_used = mark.used;
+}
+
+void Arena::reset() {
+	_block = 0;
+	_used = 0;
+}
+
+size_t Arena::capacity() const {
+	size_t total = 0;
+	for (size_t size : _sizes) {
+		total += size;
+	}
+
+	return total;
+}
\ No newline at end of file
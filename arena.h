@@ -0,0 +1,68 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Bump allocator for per-search scratch memory (move lists, child positions, PV lines, tree nodes). Allocating is a pointer bump
+ * and nothing is freed one at a time: reset() hands everything back at once in O(1), and mark()/rewind() do the same for
+ * everything allocated since a mark, which fits the stack-like lifetimes of a depth-first search. Blocks are only requested
+ * from the heap while the arena grows to its high water mark and are reused after that. Not thread safe; give every worker
+ * thread its own.
+ */
+class Arena {
+public:
+	struct Mark {
+		size_t block;
+		size_t used;
+	};
+
+	Arena(size_t blockSize = 1 << 20);
+	Arena(const Arena& other) = delete;
+
+	// never null, starts a new block (growing the arena if there's no spare one) when the current block is full
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	// uninitialized room for count Ts; T can't need a destructor since nothing is ever destroyed
+	template <typename T>
+	T* allocate(size_t count = 1) {
+		static_assert(std::is_trivially_destructible_v<T>, "arena memory is released without running destructors");
+
+		return (T*)allocate(sizeof(T) * count, alignof(T));
+	}
+
+	Mark mark() const { return {.block = _block, .used = _used}; }
+	void rewind(const Mark& mark);
+	void reset();
+
+	// bytes held from the heap, whether in use or not
+	size_t capacity() const;
+
+	Arena& operator=(const Arena& other) = delete;
+
+private:
+	size_t _blockSize;
+	std::vector<std::unique_ptr<char[]>> _blocks;
+	std::vector<size_t> _sizes;
+	size_t _block;	// index of the block being bumped
+	size_t _used;	// bytes used in it
+};
+
+// rewinds the arena to where it was at construction when it goes out of scope
+class ArenaScope {
+public:
+	ArenaScope(Arena& arena) : _arena(arena), _mark(arena.mark()) {}
+	ArenaScope(const ArenaScope& other) = delete;
+	~ArenaScope() { _arena.rewind(_mark); }
+
+	ArenaScope& operator=(const ArenaScope& other) = delete;
+
+private:
+	Arena& _arena;
+	Arena::Mark _mark;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,362 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "eval.h"
+
+using namespace std;
+
+const uint64_t NOT_A_FILE = ~0x0101010101010101ull;
+const uint64_t NOT_H_FILE = ~0x8080808080808080ull;
+const uint64_t RANK_3 = 0x0000000000FF0000ull;
+const uint64_t RANK_6 = 0x0000FF0000000000ull;
+
+// piece codes index these; the last entry of each row is the empty square
+struct BatchTables {
+	int16_t mg[64][13];	 // white's pieces positive, black's negative
+	int16_t eg[64][13];
+	uint8_t phase[13];
+
+	BatchTables() {
+		for (uint square = 0; square < 64; square++) {
+			Position pos = {.file = (Files)(square % 8), .rank = square / 8 + 1};
+
+			for (uint code = 0; code < 12; code++) {
+				Players player = (Players)(code / 6);
+				PieceTypes type = (PieceTypes)(code % 6);
+				int sign = player == Players::WHITE ? 1 : -1;
+
+				mg[square][code] = sign * mgValue(type, player, pos);
+				eg[square][code] = sign * egValue(type, player, pos);
+				phase[code] = phaseOf(type);
+			}
+
+			mg[square][BATCH_EMPTY] = eg[square][BATCH_EMPTY] = 0;
+		}
+
+		phase[BATCH_EMPTY] = 0;
+	}
+};
+
+static const BatchTables& batchTables() {
+	static const BatchTables tables;
+
+	return tables;
+}
+
+PositionBatch::PositionBatch(size_t capacity) : _size(0) {
+	for (vector<uint8_t>& square : _squares) {
+		square.reserve(capacity);
+	}
+	for (auto& player : _pieces) {
+		for (vector<uint64_t>& type : player) {
+			type.reserve(capacity);
+		}
+	}
+
+	_turn.reserve(capacity);
+	_castling.reserve(capacity);
+	_enPassant.reserve(capacity);
+}
+
+void PositionBatch::_grow() {
+	for (vector<uint8_t>& square : _squares) {
+		square.push_back(BATCH_EMPTY);
+	}
+	for (auto& player : _pieces) {
+		for (vector<uint64_t>& type : player) {
+			type.push_back(0);
+		}
+	}
+
+	_turn.push_back(Players::WHITE);
+	_castling.push_back(0);
+	_enPassant.push_back(BATCH_NO_EN_PASSANT);
+	_size++;
+}
+
+void PositionBatch::add(const Game& game) {
+	if (game.shouldPromote()) {
+		throw runtime_error("Select a promotion piece before adding a position to a batch.");
+	}
+
+	_grow();
+	size_t lane = _size - 1;
+
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		for (const Piece& piece : game.pieces(player)) {
+			uint square = squareOf(piece.position());
+
+			_squares[square][lane] = player * 6 + piece.type();
+			_pieces[player][piece.type()][lane] |= 1ull << square;
+		}
+	}
+
+	_turn[lane] = game.turn();
+	_castling[lane] = game.canCastle(Players::WHITE, true) | game.canCastle(Players::WHITE, false) << 1 | game.canCastle(Players::BLACK, true) << 2 |
+					  game.canCastle(Players::BLACK, false) << 3;
+
+	Position target;
+	if (game.enPassantTarget(target)) {
+		_enPassant[lane] = squareOf(target);
+	}
+}
+
+void PositionBatch::add(const PackedPosition& packed) {
+	uint count = popcount(packed.occupancy);
+	if (count > 32) {
+		throw runtime_error("Corrupt packed position: more than 32 pieces.");
+	}
+	for (uint idx = 0; idx < count; idx++) {
+		if ((packed.pieces[idx / 2] >> (idx % 2 * 4) & 0xF) >= 12) {
+			throw runtime_error("Corrupt packed position: bad piece code.");
+		}
+	}
+
+	_grow();
+	size_t lane = _size - 1;
+
+	uint idx = 0;
+	for (uint64_t remaining = packed.occupancy; remaining; remaining &= remaining - 1, idx++) {
+		uint square = countr_zero(remaining), code = packed.pieces[idx / 2] >> (idx % 2 * 4) & 0xF;
+
+		_squares[square][lane] = code;
+		_pieces[code / 6][code % 6][lane] |= 1ull << square;
+	}
+
+	_turn[lane] = packed.flags & 1 ? Players::BLACK : Players::WHITE;
+	_castling[lane] = packed.flags >> 1 & 0xF;
+	_enPassant[lane] = packed.enPassant;
+}
+
+void PositionBatch::clear() {
+	for (vector<uint8_t>& square : _squares) {
+		square.clear();
+	}
+	for (auto& player : _pieces) {
+		for (vector<uint64_t>& type : player) {
+			type.clear();
+		}
+	}
+
+	_turn.clear();
+	_castling.clear();
+	_enPassant.clear();
+	_size = 0;
+}
+
+void evaluateBatch(const PositionBatch& batch, int* scores) {
+	const BatchTables& tables = batchTables();
+	size_t size = batch.size();
+	vector<int> mg(size, 0), eg(size, 0), phase(size, 0);
+
+	// square by square, so each pass is the same three lookups down every position
+	for (uint square = 0; square < 64; square++) {
+		const uint8_t* codes = batch.square(square);
+		const int16_t *mgRow = tables.mg[square], *egRow = tables.eg[square];
+
+		for (size_t i = 0; i < size; i++) {
+			mg[i] += mgRow[codes[i]];
+			eg[i] += egRow[codes[i]];
+			phase[i] += tables.phase[codes[i]];
+		}
+	}
+
+	const uint8_t* turn = batch.turn();
+	for (size_t i = 0; i < size; i++) {
+		int p = min(phase[i], MAX_PHASE);
+		int score = (mg[i] * p + eg[i] * (MAX_PHASE - p)) / MAX_PHASE;
+
+		scores[i] = turn[i] == Players::WHITE ? score : -score;
+	}
+}
+
+static uint64_t shift(uint64_t bits, int by) {
+	return by > 0 ? bits << by : bits >> -by;
+}
+
+// Kogge-Stone fill: every square a slider in gen attacks in direction by (8 north, 1 east, 9 north east, ...); mask drops the
+// squares that would wrap around the board edge. Branch free, so it works the same on a whole set of sliders or a single one.
+static uint64_t slide(uint64_t gen, uint64_t empty, int by, uint64_t mask) {
+	empty &= mask;
+	gen |= empty & shift(gen, by);
+	empty &= shift(empty, by);
+	gen |= empty & shift(gen, by * 2);
+	empty &= shift(empty, by * 2);
+	gen |= empty & shift(gen, by * 4);
+
+	return mask & shift(gen, by);
+}
+
+static uint64_t diagonalAttacks(uint64_t sliders, uint64_t empty) {
+	return slide(sliders, empty, 9, NOT_A_FILE) | slide(sliders, empty, -7, NOT_A_FILE) | slide(sliders, empty, 7, NOT_H_FILE) |
+		   slide(sliders, empty, -9, NOT_H_FILE);
+}
+
+static uint64_t straightAttacks(uint64_t sliders, uint64_t empty) {
+	return slide(sliders, empty, 8, ~0ull) | slide(sliders, empty, -8, ~0ull) | slide(sliders, empty, 1, NOT_A_FILE) |
+		   slide(sliders, empty, -1, NOT_H_FILE);
+}
+
+static uint64_t knightAttacks(uint64_t knights) {
+	uint64_t east = (knights << 1) & NOT_A_FILE, west = (knights >> 1) & NOT_H_FILE;
+	uint64_t east2 = (knights << 2) & NOT_A_FILE & (NOT_A_FILE << 1), west2 = (knights >> 2) & NOT_H_FILE & (NOT_H_FILE >> 1);
+
+	return (east | west) << 16 | (east | west) >> 16 | (east2 | west2) << 8 | (east2 | west2) >> 8;
+}
+
+static uint64_t kingAttacks(uint64_t kings) {
+	uint64_t row = kings | (kings << 1 & NOT_A_FILE) | (kings >> 1 & NOT_H_FILE);
+
+	return (row | row << 8 | row >> 8) & ~kings;
+}
+
+static uint64_t pawnAttacks(uint64_t pawns, Players player) {
+	return player == Players::WHITE ? (pawns << 9 & NOT_A_FILE) | (pawns << 7 & NOT_H_FILE) : (pawns >> 7 & NOT_A_FILE) | (pawns >> 9 & NOT_H_FILE);
+}
+
+void mobilityBatch(const PositionBatch& batch, int* mobility) {
+	size_t size = batch.size();
+	const uint64_t* pieces[2][6];
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		for (const PieceTypes type : PIECE_TYPES) {
+			pieces[player][type] = batch.pieces(player, type);
+		}
+	}
+
+	const uint8_t* turn = batch.turn();
+	for (size_t i = 0; i < size; i++) {
+		uint64_t occupied[2] = {0, 0};
+		for (uint type = 0; type < 6; type++) {
+			occupied[0] |= pieces[0][type][i];
+			occupied[1] |= pieces[1][type][i];
+		}
+
+		uint64_t empty = ~(occupied[0] | occupied[1]);
+		int area[2];
+		for (uint player = 0; player < 2; player++) {
+			uint64_t queens = pieces[player][PieceTypes::QUEEN][i];
+			uint64_t attacked = knightAttacks(pieces[player][PieceTypes::KNIGHT][i]) |
+								diagonalAttacks(pieces[player][PieceTypes::BISHOP][i] | queens, empty) |
+								straightAttacks(pieces[player][PieceTypes::ROOK][i] | queens, empty);
+
+			area[player] = popcount(attacked & ~occupied[player]);
+		}
+
+		mobility[i] = turn[i] == Players::WHITE ? area[0] - area[1] : area[1] - area[0];
+	}
+}
+
+// one position's bitboards, for checking moves one at a time
+struct LaneBoard {
+	uint64_t pieces[2][6];
+	uint64_t occupied[2];
+
+	bool attacked(uint square, Players by) const {
+		uint64_t target = 1ull << square, empty = ~(occupied[0] | occupied[1]);
+		const uint64_t* theirs = pieces[by];
+
+		return (knightAttacks(target) & theirs[PieceTypes::KNIGHT]) || (kingAttacks(target) & theirs[PieceTypes::KING]) ||
+			   (pawnAttacks(target, by == Players::WHITE ? Players::BLACK : Players::WHITE) & theirs[PieceTypes::PAWN]) ||
+			   (diagonalAttacks(target, empty) & (theirs[PieceTypes::BISHOP] | theirs[PieceTypes::QUEEN])) ||
+			   (straightAttacks(target, empty) & (theirs[PieceTypes::ROOK] | theirs[PieceTypes::QUEEN]));
+	}
+
+	// plays the move on a copy and checks the mover's king; captured is the square of the taken piece (differs for en passant)
+	bool legal(Players us, PieceTypes type, uint from, uint to, uint captured) const {
+		LaneBoard after = *this;
+		Players them = us == Players::WHITE ? Players::BLACK : Players::WHITE;
+		uint64_t move = 1ull << from | 1ull << to, taken = 1ull << captured;
+
+		after.pieces[us][type] ^= move;
+		after.occupied[us] ^= move;
+		if (after.occupied[them] & taken) {
+			for (uint64_t& bits : after.pieces[them]) {
+				bits &= ~taken;
+			}
+			after.occupied[them] &= ~taken;
+		}
+
+		return !after.attacked(countr_zero(after.pieces[us][PieceTypes::KING]), them);
+	}
+};
+
+void countMovesBatch(const PositionBatch& batch, uint16_t* counts) {
+	size_t size = batch.size();
+
+	for (size_t i = 0; i < size; i++) {
+		LaneBoard board;
+		for (const Players player : {Players::WHITE, Players::BLACK}) {
+			board.occupied[player] = 0;
+			for (const PieceTypes type : PIECE_TYPES) {
+				board.pieces[player][type] = batch.pieces(player, type)[i];
+				board.occupied[player] |= board.pieces[player][type];
+			}
+		}
+
+		Players us = (Players)batch.turn()[i], them = us == Players::WHITE ? Players::BLACK : Players::WHITE;
+		uint64_t empty = ~(board.occupied[0] | board.occupied[1]), own = board.occupied[us];
+		uint count = 0;
+
+		auto countTargets = [&](PieceTypes type, uint from, uint64_t targets) {
+			for (; targets; targets &= targets - 1) {
+				uint to = countr_zero(targets);
+				count += board.legal(us, type, from, to, to);
+			}
+		};
+
+		for (const PieceTypes type : {PieceTypes::KNIGHT, PieceTypes::BISHOP, PieceTypes::ROOK, PieceTypes::QUEEN, PieceTypes::KING}) {
+			for (uint64_t remaining = board.pieces[us][type]; remaining; remaining &= remaining - 1) {
+				uint from = countr_zero(remaining);
+				uint64_t bit = 1ull << from, targets = 0;
+
+				if (type == PieceTypes::KNIGHT) {
+					targets = knightAttacks(bit);
+				} else if (type == PieceTypes::KING) {
+					targets = kingAttacks(bit);
+				}
+				if (type == PieceTypes::BISHOP || type == PieceTypes::QUEEN) {
+					targets |= diagonalAttacks(bit, empty);
+				}
+				if (type == PieceTypes::ROOK || type == PieceTypes::QUEEN) {
+					targets |= straightAttacks(bit, empty);
+				}
+
+				countTargets(type, from, targets & ~own);
+			}
+		}
+
+		int forward = us == Players::WHITE ? 8 : -8;
+		uint8_t enPassant = batch.enPassant()[i];
+		uint64_t enPassantBit = enPassant == BATCH_NO_EN_PASSANT ? 0 : 1ull << enPassant;
+
+		for (uint64_t remaining = board.pieces[us][PieceTypes::PAWN]; remaining; remaining &= remaining - 1) {
+			uint from = countr_zero(remaining);
+			uint64_t bit = 1ull << from, single = shift(bit, forward) & empty;
+			uint64_t twice = shift(single & (us == Players::WHITE ? RANK_3 : RANK_6), forward) & empty;
+
+			countTargets(PieceTypes::PAWN, from, single | twice | (pawnAttacks(bit, us) & board.occupied[them]));
+
+			if (pawnAttacks(bit, us) & enPassantBit) {
+				count += board.legal(us, PieceTypes::PAWN, from, enPassant, enPassant - forward);
+			}
+		}
+
+		// rights imply the king and rook are still home; the king can't start in or pass through check
+		uint8_t rights = batch.castling()[i] >> (us * 2);
+		uint kingSquare = us == Players::WHITE ? 4 : 60;
+		if ((rights & 3) && !board.attacked(kingSquare, them)) {
+			uint64_t kingSideBetween = 0x60ull << (kingSquare - 4), queenSideBetween = 0x0Eull << (kingSquare - 4);
+
+			if ((rights & 1) && !(kingSideBetween & ~empty) && !board.attacked(kingSquare + 1, them)) {
+				count += board.legal(us, PieceTypes::KING, kingSquare, kingSquare + 2, kingSquare + 2);
+			}
+			if ((rights & 2) && !(queenSideBetween & ~empty) && !board.attacked(kingSquare - 1, them)) {
+				count += board.legal(us, PieceTypes::KING, kingSquare, kingSquare - 2, kingSquare - 2);
+			}
+		}
+
+		counts[i] = count;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "chess.h"
+#include "packed.h"
+
+const uint8_t BATCH_EMPTY = 12;	 // piece code of an empty square (occupied squares are player * 6 + type, like PackedPosition)
+
+const uint8_t BATCH_NO_EN_PASSANT = 0xFF;
+
+/*
+ * Many positions stored structure-of-arrays: every field is its own array with one entry ("lane") per position, so the batch
+ * kernels below run the same arithmetic down contiguous memory and the compiler can spread it across SIMD lanes instead of walking
+ * one Game's piece vectors at a time. Squares are stored both ways: square-major piece codes for the table lookups of the
+ * evaluation, and per player/type bitboards for everything that works on sets of squares.
+ */
+class PositionBatch {
+public:
+	PositionBatch(size_t capacity = 0);
+
+	void add(const Game& game);
+	// straight from a dataset record, without building a Game first
+	void add(const PackedPosition& packed);
+
+	void clear();
+
+	size_t size() const { return _size; }
+
+	// piece codes on square (squareOf) for every position
+	const uint8_t* square(uint square) const { return _squares[square].data(); }
+	const uint64_t* pieces(Players player, PieceTypes type) const { return _pieces[player][type].data(); }
+	const uint8_t* turn() const { return _turn.data(); }  // Players
+	const uint8_t* castling() const { return _castling.data(); }  // bits K, Q, k, q like PackedPosition (without the turn bit)
+	const uint8_t* enPassant() const { return _enPassant.data(); }	// square, BATCH_NO_EN_PASSANT if none
+
+private:
+	size_t _size;
+	std::vector<uint8_t> _squares[64];
+	std::vector<uint64_t> _pieces[2][6];
+	std::vector<uint8_t> _turn;
+	std::vector<uint8_t> _castling;
+	std::vector<uint8_t> _enPassant;
+
+	void _grow();
+};
+
+// same as evaluate(game) (tapered material and piece-square tables, side to move's point of view) for every position
+void evaluateBatch(const PositionBatch& batch, int* scores);
+
+// squares attacked by the side to move's knights, bishops, rooks and queens that it doesn't occupy itself, minus the same for the
+// other side; attacks are unioned per side, so a square covered twice counts once
+void mobilityBatch(const PositionBatch& batch, int* mobility);
+
+// number of legal moves in every position, counting a promotion once like Game::getAvailableMoves; works on the bitboards, so
+// it's much faster than getAvailableMoves, but each position is still its own loop
+void countMovesBatch(const PositionBatch& batch, uint16_t* counts);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "chess.h"
+#include "search.h"
+#include "stats.h"
+
+using namespace std;
+
+const uint DEFAULT_BENCH_DEPTH = 4;
+
+// nodes per position kept for trace=, enough for depth 3 or so
+const size_t DEFAULT_TRACE_LIMIT = 100000;
+
+// part of the signature too: a different table size changes what gets cut off
+const size_t BENCH_TT_ENTRIES = 1 << 16;
+
+// built in so the node count means the same thing everywhere, only ever append (and expect every signature to change)
+const char* BENCH_POSITIONS[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3",
+	"2rq1rk1/pb1nbppp/1p2pn2/2pp4/3P4/1P1BPN2/PBPN1PPP/2RQ1RK1 w - - 0 11",
+	"6k1/5p2/6p1/8/7P/6P1/r4PK1/1R6 b - - 0 40",
+	"8/8/4k3/8/2K5/8/3P4/8 w - - 0 1",
+	"r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+	"8/5pk1/6p1/3Q4/8/6P1/q4PK1/8 b - - 0 50",
+};
+
+/*
+ * Fixed depth searches over the built in positions, one thread, a fresh hash table for each. The node total is a signature of
+ * the search's behaviour (it only changes when the search does), and nodes/s is the speed figure; a commit that only speeds
+ * things up keeps the signature. stats= writes every iteration's statistics as JSON lines and trace= the searched tree (bounded
+ * by tracelimit= nodes per position), both tagged with the position's number.
+ */
+int main(int argc, char** argv) {
+	uint depth = DEFAULT_BENCH_DEPTH;
+	size_t traceLimit = DEFAULT_TRACE_LIMIT;
+	unique_ptr<ofstream> statsOut, traceOut;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			string option = argv[i];
+
+			if (option.rfind("depth=", 0) == 0) {
+				depth = stoul(option.substr(6));
+			} else if (option.rfind("stats=", 0) == 0) {
+				statsOut = make_unique<ofstream>(option.substr(6));
+			} else if (option.rfind("trace=", 0) == 0) {
+				traceOut = make_unique<ofstream>(option.substr(6));
+			} else if (option.rfind("tracelimit=", 0) == 0) {
+				traceLimit = stoull(option.substr(11));
+			} else {
+				throw runtime_error("Bad option '" + option + "'.");
+			}
+		}
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		cout << "Usage: " << argv[0] << " [depth=N (default " << DEFAULT_BENCH_DEPTH << ")] [stats=file.jsonl] [trace=file.jsonl] [tracelimit=N]"
+			 << endl;
+		return 1;
+	}
+
+	uint64_t totalNodes = 0;
+	auto start = chrono::steady_clock::now();
+
+	try {
+		if ((statsOut && !*statsOut) || (traceOut && !*traceOut)) {
+			throw runtime_error("Couldn't open the stats or trace file.");
+		}
+
+		uint idx = 1;
+		for (const char* fen : BENCH_POSITIONS) {
+			Searcher searcher(BENCH_TT_ENTRIES);
+			if (traceOut) {
+				searcher.setTrace(traceLimit);
+			}
+
+			// {"position":N, then the rest of the object
+			string tag = "{\"position\":" + to_string(idx) + ",";
+
+			SearchResult result = searcher.search(Game(fen), {.depth = depth}, nullptr, [&](const SearchResult& progress) {
+				if (statsOut) {
+					*statsOut << tag << toJSON(progress).substr(1) << "\n";
+				}
+			});
+
+			if (traceOut) {
+				for (const TraceEntry& entry : searcher.trace()) {
+					*traceOut << tag << toJSON(entry).substr(1) << "\n";
+				}
+				if (searcher.traceTruncated()) {
+					cout << "Trace of position " << idx << " cut off at " << traceLimit << " nodes" << endl;
+				}
+			}
+
+			cout << "Position " << idx++ << ": " << result.nodes << " nodes, " << result.milliseconds << " ms" << endl;
+			totalNodes += result.nodes;
+		}
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+
+	uint64_t milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+	cout << "===========================" << endl;
+	cout << "Total time (ms) : " << milliseconds << endl;
+	cout << "Nodes searched  : " << totalNodes << endl;
+	cout << "Nodes/second    : " << totalNodes * 1000 / max<uint64_t>(milliseconds, 1) << endl;
+
+#ifdef CHESS_STATS
+	cout << "===========================" << endl;
+	printStats(cout);
+#endif
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "bitbase.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cout << "Usage: " << argv[0] << " <output directory> [threads (default all cores)]" << endl;
+		return 1;
+	}
+
+	string directory = argv[1];
+	uint threads = argc > 2 ? stoi(argv[2]) : max(1u, thread::hardware_concurrency());
+
+	// KPK promotes into KQK and KRK, so those have to be done first
+	vector<uint8_t> tables[4];
+	for (const Endgames endgame : {Endgames::KQK, Endgames::KRK, Endgames::KPK, Endgames::KBNK}) {
+		auto start = chrono::steady_clock::now();
+
+		try {
+			tables[endgame] = generateBitbase(endgame, threads, &tables[Endgames::KQK], &tables[Endgames::KRK]);
+			writeBitbase(directory + "/" + ENDGAME_NAMES[endgame] + ".bb", endgame, tables[endgame]);
+		} catch (const runtime_error& e) {
+			cout << e.what() << endl;
+			return 1;
+		}
+
+		size_t wins = 0;
+		for (uint8_t byte : tables[endgame]) {
+			wins += __builtin_popcount(byte);
+		}
+
+		auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+		cout << ENDGAME_NAMES[endgame] << ": " << bitbaseSize(endgame) << " positions, " << wins << " wins, " << elapsed << "ms" << endl;
+	}
+
+	return 0;
+}
\ No newline at end of file
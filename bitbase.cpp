@@ -0,0 +1,549 @@
+#include "bitbase.h"
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+const Endgames ENDGAMES[4] = {Endgames::KPK, Endgames::KRK, Endgames::KQK, Endgames::KBNK};
+const char* const ENDGAME_NAMES[4] = {"KPK", "KRK", "KQK", "KBNK"};
+
+const uint BITBASE_HEADER_SIZE = 16;
+
+// the strong king is folded into the a1-d1-d4 triangle for pawnless endgames
+const int TRIANGLE_SQUARES[10] = {0, 1, 2, 3, 9, 10, 11, 18, 19, 27};
+const int TRIANGLE_INDEX[64] = {0,	1,	2,	3,	-1, -1, -1, -1, -1, 4,	5,	6,	-1, -1, -1, -1, -1, -1, 7,	8,	-1, -1,
+								-1, -1, -1, -1, -1, 9,	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+								-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+const int KING_DELTAS[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+const int KNIGHT_DELTAS[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+const int DIAGONAL_DELTAS[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+const int STRAIGHT_DELTAS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+enum BitbaseStates : uint8_t { UNRESOLVED, WON, DRAWN, ILLEGAL };
+
+// squares are 0-63 (squareOf); the strong side is always white here, weakToMove means black is on the move
+struct Setup {
+	bool weakToMove;
+	int strongKing;
+	int weakKing;
+	int numPieces;
+	int pieces[2];
+	PieceTypes types[2];
+};
+
+static int fileOf(int square) {
+	return square % 8;
+}
+
+static int rankOf(int square) {
+	return square / 8;
+}
+
+static int distance(int a, int b) {
+	return max(abs(fileOf(a) - fileOf(b)), abs(rankOf(a) - rankOf(b)));
+}
+
+static int offset(int square, int df, int dr) {
+	int file = fileOf(square) + df, rank = rankOf(square) + dr;
+
+	return file < 0 || file > 7 || rank < 0 || rank > 7 ? -1 : rank * 8 + file;
+}
+
+static void pieceTypesOf(Endgames endgame, PieceTypes types[2], int& numPieces) {
+	numPieces = endgame == Endgames::KBNK ? 2 : 1;
+
+	switch (endgame) {
+		case Endgames::KPK:
+			types[0] = PieceTypes::PAWN;
+			break;
+		case Endgames::KRK:
+			types[0] = PieceTypes::ROOK;
+			break;
+		case Endgames::KQK:
+			types[0] = PieceTypes::QUEEN;
+			break;
+		case Endgames::KBNK:
+			types[0] = PieceTypes::BISHOP;
+			types[1] = PieceTypes::KNIGHT;
+			break;
+	}
+}
+
+size_t bitbaseSize(Endgames endgame) {
+	switch (endgame) {
+		case Endgames::KPK:
+			return 2 * 64 * 64 * 24;
+		case Endgames::KBNK:
+			return 2 * 10 * 64 * 64 * 64;
+		default:
+			return 2 * 10 * 64 * 64;
+	}
+}
+
+// folds the position onto its canonical symmetric copy and returns its index
+static size_t indexOf(Endgames endgame, const Setup& setup) {
+	int squares[4] = {setup.strongKing, setup.weakKing, setup.pieces[0], setup.pieces[1]};
+	int numSquares = 2 + setup.numPieces;
+
+	if (endgame == Endgames::KPK) {
+		// pawns break every symmetry but the vertical mirror
+		if (fileOf(squares[2]) > 3) {
+			for (int i = 0; i < numSquares; i++) {
+				squares[i] ^= 7;
+			}
+		}
+
+		size_t pawnIdx = (rankOf(squares[2]) - 1) * 4 + fileOf(squares[2]);
+
+		return ((size_t)(setup.weakToMove ? 1 : 0) * 64 * 64 + squares[0] * 64 + squares[1]) * 24 + pawnIdx;
+	}
+
+	if (fileOf(squares[0]) > 3) {
+		for (int i = 0; i < numSquares; i++) {
+			squares[i] ^= 7;
+		}
+	}
+	if (rankOf(squares[0]) > 3) {
+		for (int i = 0; i < numSquares; i++) {
+			squares[i] ^= 56;
+		}
+	}
+	if (rankOf(squares[0]) > fileOf(squares[0])) {
+		for (int i = 0; i < numSquares; i++) {
+			squares[i] = fileOf(squares[i]) * 8 + rankOf(squares[i]);
+		}
+	}
+
+	size_t idx = (setup.weakToMove ? 1 : 0) * 10 + TRIANGLE_INDEX[squares[0]];
+	for (int i = 1; i < numSquares; i++) {
+		idx = idx * 64 + squares[i];
+	}
+
+	return idx;
+}
+
+static Setup setupAt(Endgames endgame, size_t idx) {
+	Setup setup;
+	pieceTypesOf(endgame, setup.types, setup.numPieces);
+
+	if (endgame == Endgames::KPK) {
+		int pawnIdx = idx % 24;
+		idx /= 24;
+
+		setup.pieces[0] = (pawnIdx / 4 + 1) * 8 + pawnIdx % 4;
+		setup.weakKing = idx % 64;
+		setup.strongKing = idx / 64 % 64;
+		setup.weakToMove = idx / (64 * 64) == 1;
+
+		return setup;
+	}
+
+	for (int i = setup.numPieces - 1; i >= 0; i--) {
+		setup.pieces[i] = idx % 64;
+		idx /= 64;
+	}
+
+	setup.weakKing = idx % 64;
+	setup.strongKing = TRIANGLE_SQUARES[idx / 64 % 10];
+	setup.weakToMove = idx / 640 == 1;
+
+	return setup;
+}
+
+static uint64_t occupancyOf(const Setup& setup) {
+	uint64_t occupied = 1ull << setup.strongKing | 1ull << setup.weakKing;
+
+	for (int i = 0; i < setup.numPieces; i++) {
+		occupied |= 1ull << setup.pieces[i];
+	}
+
+	return occupied;
+}
+
+static bool slides(int from, int target, const int (*deltas)[2], uint64_t occupied) {
+	for (int d = 0; d < 4; d++) {
+		for (int square = offset(from, deltas[d][0], deltas[d][1]); square != -1; square = offset(square, deltas[d][0], deltas[d][1])) {
+			if (square == target) {
+				return true;
+			}
+			if (occupied >> square & 1) {
+				break;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool attacks(PieceTypes type, int from, int target, uint64_t occupied) {
+	int df = abs(fileOf(from) - fileOf(target)), dr = abs(rankOf(from) - rankOf(target));
+
+	switch (type) {
+		case PieceTypes::PAWN:
+			return df == 1 && rankOf(target) == rankOf(from) + 1;
+		case PieceTypes::KNIGHT:
+			return (df == 1 && dr == 2) || (df == 2 && dr == 1);
+		case PieceTypes::BISHOP:
+			return df == dr && df != 0 && slides(from, target, DIAGONAL_DELTAS, occupied);
+		case PieceTypes::ROOK:
+			return (df == 0) != (dr == 0) && slides(from, target, STRAIGHT_DELTAS, occupied);
+		case PieceTypes::QUEEN:
+			return attacks(PieceTypes::BISHOP, from, target, occupied) || attacks(PieceTypes::ROOK, from, target, occupied);
+		case PieceTypes::KING:
+			return distance(from, target) == 1;
+	}
+
+	return false;
+}
+
+// ignored is the index of a piece that's just been captured (or -1)
+static bool strongAttacks(const Setup& setup, int target, uint64_t occupied, int ignored) {
+	if (distance(setup.strongKing, target) <= 1) {
+		return true;
+	}
+
+	for (int i = 0; i < setup.numPieces; i++) {
+		if (i != ignored && attacks(setup.types[i], setup.pieces[i], target, occupied)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool isLegal(const Setup& setup) {
+	uint64_t occupied = occupancyOf(setup);
+
+	if (__builtin_popcountll(occupied) != 2 + setup.numPieces || distance(setup.strongKing, setup.weakKing) <= 1) {
+		return false;
+	}
+
+	// the weak king can't be in check with the strong side on the move
+	return setup.weakToMove || !strongAttacks(setup, setup.weakKing, occupied, -1);
+}
+
+static BitbaseStates stateAt(const vector<uint8_t>& states, Endgames endgame, const Setup& setup) {
+	return (BitbaseStates)states[indexOf(endgame, setup)];
+}
+
+static bool bitAt(const vector<uint8_t>& bits, Endgames endgame, const Setup& setup) {
+	size_t idx = indexOf(endgame, setup);
+
+	return bits[idx / 8] >> (idx % 8) & 1;
+}
+
+// the lone king's options: DRAWN if it can take something or is stalemated, WON if mated or every move loses, UNRESOLVED otherwise
+static BitbaseStates resolveWeak(const Setup& setup, Endgames endgame, const vector<uint8_t>& states) {
+	uint64_t occupied = occupancyOf(setup) & ~(1ull << setup.weakKing);
+	bool hasMove = false, allLose = true;
+
+	for (const auto& delta : KING_DELTAS) {
+		int to = offset(setup.weakKing, delta[0], delta[1]);
+		if (to == -1 || distance(to, setup.strongKing) <= 1) {
+			continue;
+		}
+
+		int captured = -1;
+		for (int i = 0; i < setup.numPieces; i++) {
+			if (setup.pieces[i] == to) {
+				captured = i;
+			}
+		}
+
+		if (strongAttacks(setup, to, occupied, captured)) {
+			continue;
+		}
+		if (captured != -1) {
+			return BitbaseStates::DRAWN;  // nothing left that can mate
+		}
+
+		hasMove = true;
+
+		Setup next = setup;
+		next.weakToMove = false;
+		next.weakKing = to;
+
+		if (stateAt(states, endgame, next) != BitbaseStates::WON) {
+			allLose = false;
+		}
+	}
+
+	if (!hasMove) {
+		return strongAttacks(setup, setup.weakKing, occupied, -1) ? BitbaseStates::WON : BitbaseStates::DRAWN;
+	}
+
+	return allLose ? BitbaseStates::WON : BitbaseStates::UNRESOLVED;
+}
+
+static BitbaseStates resolveStrong(const Setup& setup, Endgames endgame, const vector<uint8_t>& states, const vector<uint8_t>* queenBits,
+								   const vector<uint8_t>* rookBits) {
+	uint64_t occupied = occupancyOf(setup);
+	bool hasMove = false;
+
+	for (const auto& delta : KING_DELTAS) {
+		int to = offset(setup.strongKing, delta[0], delta[1]);
+		if (to == -1 || (occupied >> to & 1) || distance(to, setup.weakKing) <= 1) {
+			continue;
+		}
+
+		Setup next = setup;
+		next.weakToMove = true;
+		next.strongKing = to;
+
+		hasMove = true;
+		if (stateAt(states, endgame, next) == BitbaseStates::WON) {
+			return BitbaseStates::WON;
+		}
+	}
+
+	for (int i = 0; i < setup.numPieces; i++) {
+		int targets[28], numTargets = 0, from = setup.pieces[i];
+
+		switch (setup.types[i]) {
+			case PieceTypes::PAWN: {
+				int push = from + 8;
+
+				if (!(occupied >> push & 1)) {
+					targets[numTargets++] = push;
+
+					if (rankOf(from) == 1 && !(occupied >> (push + 8) & 1)) {
+						targets[numTargets++] = push + 8;
+					}
+				}
+				break;
+			}
+			case PieceTypes::KNIGHT:
+				for (const auto& delta : KNIGHT_DELTAS) {
+					int to = offset(from, delta[0], delta[1]);
+
+					if (to != -1 && !(occupied >> to & 1)) {
+						targets[numTargets++] = to;
+					}
+				}
+				break;
+			default: {
+				bool diagonal = setup.types[i] != PieceTypes::ROOK, straight = setup.types[i] != PieceTypes::BISHOP;
+
+				for (const auto& delta : KING_DELTAS) {
+					if ((delta[0] != 0 && delta[1] != 0) ? !diagonal : !straight) {
+						continue;
+					}
+
+					for (int to = offset(from, delta[0], delta[1]); to != -1 && !(occupied >> to & 1); to = offset(to, delta[0], delta[1])) {
+						targets[numTargets++] = to;
+					}
+				}
+				break;
+			}
+		}
+
+		for (int t = 0; t < numTargets; t++) {
+			Setup next = setup;
+			next.weakToMove = true;
+			next.pieces[i] = targets[t];
+			hasMove = true;
+
+			if (setup.types[i] == PieceTypes::PAWN && rankOf(targets[t]) == 7) {
+				// promotions continue in the queen and rook tables (minor promotions can't force mate)
+				next.types[i] = PieceTypes::QUEEN;
+				if (queenBits && bitAt(*queenBits, Endgames::KQK, next)) {
+					return BitbaseStates::WON;
+				}
+
+				next.types[i] = PieceTypes::ROOK;
+				if (rookBits && bitAt(*rookBits, Endgames::KRK, next)) {
+					return BitbaseStates::WON;
+				}
+			} else if (stateAt(states, endgame, next) == BitbaseStates::WON) {
+				return BitbaseStates::WON;
+			}
+		}
+	}
+
+	return hasMove ? BitbaseStates::UNRESOLVED : BitbaseStates::DRAWN;
+}
+
+// runs work(begin, end) over [0, size) split evenly across threads, returns the sum of what the workers return
+template <typename Work>
+static size_t parallelFor(size_t size, uint threads, Work work) {
+	atomic<size_t> total(0);
+	vector<thread> workers;
+	size_t chunk = (size + threads - 1) / threads;
+
+	for (uint t = 0; t < threads; t++) {
+		size_t begin = min(size, t * chunk), end = min(size, begin + chunk);
+
+		workers.emplace_back([&, begin, end]() { total += work(begin, end); });
+	}
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	return total;
+}
+
+vector<uint8_t> generateBitbase(Endgames endgame, uint threads, const vector<uint8_t>* queenBits, const vector<uint8_t>* rookBits) {
+	if (threads == 0) {
+		threads = 1;
+	}
+	if (endgame == Endgames::KPK && (!queenBits || !rookBits)) {
+		throw runtime_error("KPK generation needs the KQK and KRK bitbases for promotions.");
+	}
+
+	size_t size = bitbaseSize(endgame);
+	vector<uint8_t> states(size), next(size);
+
+	parallelFor(size, threads, [&](size_t begin, size_t end) {
+		for (size_t idx = begin; idx < end; idx++) {
+			Setup setup = setupAt(endgame, idx);
+
+			states[idx] = isLegal(setup) ? BitbaseStates::UNRESOLVED : BitbaseStates::ILLEGAL;
+		}
+
+		return (size_t)0;
+	});
+
+	// each pass only reads the previous pass's states, so threads never see a half-written table
+	size_t changed;
+	do {
+		next = states;
+
+		changed = parallelFor(size, threads, [&](size_t begin, size_t end) {
+			size_t changes = 0;
+
+			for (size_t idx = begin; idx < end; idx++) {
+				if (states[idx] != BitbaseStates::UNRESOLVED) {
+					continue;
+				}
+
+				Setup setup = setupAt(endgame, idx);
+				BitbaseStates state = setup.weakToMove ? resolveWeak(setup, endgame, states) : resolveStrong(setup, endgame, states, queenBits, rookBits);
+
+				if (state != BitbaseStates::UNRESOLVED) {
+					next[idx] = state;
+					changes++;
+				}
+			}
+
+			return changes;
+		});
+
+		swap(states, next);
+	} while (changed > 0);
+
+	vector<uint8_t> bits((size + 7) / 8);
+	for (size_t idx = 0; idx < size; idx++) {
+		if (states[idx] == BitbaseStates::WON) {
+			bits[idx / 8] |= 1 << (idx % 8);
+		}
+	}
+
+	return bits;
+}
+
+static void writeUint32(ofstream& out, uint32_t value) {
+	unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+	out.write((const char*)bytes, 4);
+}
+
+static uint32_t readUint32(const unsigned char* bytes) {
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+void writeBitbase(const string& path, Endgames endgame, const vector<uint8_t>& bits) {
+	ofstream out(path, ios::binary);
+	if (!out) {
+		throw runtime_error("Could not open " + path + " for writing.");
+	}
+
+	out.write("CEBB", 4);
+	writeUint32(out, 1);
+	writeUint32(out, endgame);
+	writeUint32(out, bitbaseSize(endgame));
+	out.write((const char*)bits.data(), bits.size());
+
+	if (!out) {
+		throw runtime_error("Failed writing bitbase " + path + ".");
+	}
+}
+
+Bitbases::Bitbases(const string& directory) {
+	for (const Endgames endgame : ENDGAMES) {
+		string path = directory + "/" + ENDGAME_NAMES[endgame] + ".bb";
+
+		if (!ifstream(path)) {
+			continue;
+		}
+
+		_tables[endgame] = make_unique<MappedFile>(path);
+
+		const unsigned char* data = _tables[endgame]->data();
+		if (_tables[endgame]->size() != BITBASE_HEADER_SIZE + (bitbaseSize(endgame) + 7) / 8 || memcmp(data, "CEBB", 4) != 0 ||
+			readUint32(data + 4) != 1 || readUint32(data + 8) != (uint32_t)endgame || readUint32(data + 12) != bitbaseSize(endgame)) {
+			throw runtime_error("Bitbase " + path + " is corrupt or from a different version.");
+		}
+	}
+}
+
+bool Bitbases::has(Endgames endgame) const {
+	return _tables[endgame] != nullptr;
+}
+
+BitbaseResults Bitbases::probe(const Game& game) const {
+	const PieceList&white = game.pieces(Players::WHITE), &black = game.pieces(Players::BLACK);
+
+	// a pawn waiting on the last rank is in no table (and would index past the pawn squares)
+	if (game.shouldPromote() || white.size() + black.size() > 4 || (white.size() > 1) == (black.size() > 1)) {
+		return BitbaseResults::UNKNOWN;
+	}
+
+	Players strong = white.size() > 1 ? Players::WHITE : Players::BLACK;
+	const PieceList& strongPieces = strong == Players::WHITE ? white : black;
+	int flip = strong == Players::WHITE ? 0 : 56;  // tables are built with the strong side as white
+
+	Setup setup;
+	setup.weakToMove = game.turn() != strong;
+	setup.weakKing = squareOf((strong == Players::WHITE ? black : white)[0].position()) ^ flip;
+	setup.numPieces = 0;
+
+	for (const Piece& piece : strongPieces) {
+		if (piece.type() == PieceTypes::KING) {
+			setup.strongKing = squareOf(piece.position()) ^ flip;
+		} else {
+			setup.types[setup.numPieces] = piece.type();
+			setup.pieces[setup.numPieces++] = squareOf(piece.position()) ^ flip;
+		}
+	}
+
+	Endgames endgame;
+	if (setup.numPieces == 1 && setup.types[0] == PieceTypes::PAWN) {
+		endgame = Endgames::KPK;
+	} else if (setup.numPieces == 1 && setup.types[0] == PieceTypes::ROOK) {
+		endgame = Endgames::KRK;
+	} else if (setup.numPieces == 1 && setup.types[0] == PieceTypes::QUEEN) {
+		endgame = Endgames::KQK;
+	} else if (setup.numPieces == 2 && ((setup.types[0] == PieceTypes::BISHOP && setup.types[1] == PieceTypes::KNIGHT) ||
+										(setup.types[0] == PieceTypes::KNIGHT && setup.types[1] == PieceTypes::BISHOP))) {
+		endgame = Endgames::KBNK;
+
+		if (setup.types[0] == PieceTypes::KNIGHT) {
+			swap(setup.pieces[0], setup.pieces[1]);
+			swap(setup.types[0], setup.types[1]);
+		}
+	} else {
+		return BitbaseResults::UNKNOWN;
+	}
+
+	if (!_tables[endgame]) {
+		return BitbaseResults::UNKNOWN;
+	}
+
+	size_t idx = indexOf(endgame, setup);
+	bool won = _tables[endgame]->data()[BITBASE_HEADER_SIZE + idx / 8] >> (idx % 8) & 1;
+
+	return !won ? BitbaseResults::DRAW : setup.weakToMove ? BitbaseResults::LOSS : BitbaseResults::WIN;
+}
\ No newline at end of file
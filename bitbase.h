@@ -0,0 +1,51 @@
+#ifndef BITBASE_H
+#define BITBASE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+#include "mapped_file.h"
+
+// a lone king against king + the listed pieces
+enum Endgames { KPK, KRK, KQK, KBNK };
+enum BitbaseResults { UNKNOWN, LOSS, DRAW, WIN };
+
+extern const Endgames ENDGAMES[4];
+extern const char* const ENDGAME_NAMES[4];
+
+/*
+ * On-disk layout (little-endian):
+ *   char[4]  magic "CEBB"
+ *   uint32   version (1)
+ *   uint32   endgame (Endgames)
+ *   uint32   positions
+ *   uint8    bits[(positions + 7) / 8], bit i of byte i / 8 set when the stronger side wins position i
+ *
+ * The weaker side can never win, so one bit per position is enough. Castling rights are ignored.
+ */
+class Bitbases {
+public:
+	// maps whichever of <directory>/KPK.bb, KRK.bb, KQK.bb and KBNK.bb exist
+	Bitbases(const std::string& directory);
+
+	bool has(Endgames endgame) const;
+
+	// result for the side to move, UNKNOWN if the material isn't covered (or its table wasn't found)
+	BitbaseResults probe(const Game& game) const;
+
+private:
+	std::unique_ptr<MappedFile> _tables[4];
+};
+
+size_t bitbaseSize(Endgames endgame);
+
+// retrograde analysis over every position of the endgame, split across threads; KPK promotes into the finished KQK and KRK tables
+std::vector<uint8_t> generateBitbase(Endgames endgame, uint threads, const std::vector<uint8_t>* queenBits = nullptr,
+									 const std::vector<uint8_t>* rookBits = nullptr);
+
+void writeBitbase(const std::string& path, Endgames endgame, const std::vector<uint8_t>& bits);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "chess.h"
+#include "pgn.h"
+#include "polyglot.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		cout << "Usage: " << argv[0] << " <games.pgn> <book.bin> [max plies (default 24)] [threads (default all cores)]" << endl;
+		return 1;
+	}
+
+	uint maxPlies = argc > 3 ? stoi(argv[3]) : 24;
+	uint threads = argc > 4 ? stoi(argv[4]) : max(1u, thread::hardware_concurrency());
+
+	// polyglot-style weights: 2 for every win with the move, 1 for every draw; each thread fills its own map and they're merged after
+	vector<map<uint64_t, map<uint16_t, uint64_t>>> threadScores(threads);
+	vector<uint> threadSkipped(threads, 0);
+	mutex logLock;
+	size_t games;
+
+	try {
+		games = ingestPGN(argv[1], threads, [&](const PGNGame& pgn, uint thread) {
+			try {
+				Game game = pgn.start();
+
+				for (uint ply = 0; ply < pgn.moves.size() && ply < maxPlies; ply++) {
+					PieceTypes promotion;
+					Move move = decodeSAN(game, pgn.moves[ply], promotion);
+					uint64_t key = polyglotKey(game);
+
+					const string& result = pgn.result;
+					uint64_t score = result == "1/2-1/2" ? 1 : (result == "1-0") == (game.turn() == Players::WHITE) && result != "*" ? 2 : 0;
+					threadScores[thread][key][encodePolyglotMove(game, move, promotion)] += score;
+
+					if (game.move(move)) {
+						game.promote(move.to, promotion);
+					}
+				}
+			} catch (const runtime_error& e) {
+				lock_guard<mutex> guard(logLock);
+				cerr << "Skipping rest of game: " << e.what() << endl;
+				threadSkipped[thread]++;
+			}
+		});
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+
+	map<uint64_t, map<uint16_t, uint64_t>>& scores = threadScores[0];
+	uint skipped = threadSkipped[0];
+	for (uint t = 1; t < threads; t++) {
+		for (const auto& [key, positionScores] : threadScores[t]) {
+			for (const auto& [move, score] : positionScores) {
+				scores[key][move] += score;
+			}
+		}
+		skipped += threadSkipped[t];
+	}
+
+	uint64_t maxScore = 0;
+	for (const auto& [key, positionScores] : scores) {
+		for (const auto& [move, score] : positionScores) {
+			maxScore = max(maxScore, score);
+		}
+	}
+
+	vector<PolyglotEntry> entries;
+	for (const auto& [key, positionScores] : scores) {
+		for (const auto& [move, score] : positionScores) {
+			if (score == 0) {
+				continue;  // only ever lost with, not worth suggesting
+			}
+
+			// squash into 16 bits without letting a rare move round down to "never play"
+			uint64_t weight = maxScore > 0xFFFF ? max<uint64_t>(1, score * 0xFFFF / maxScore) : score;
+			entries.push_back({.key = key, .move = move, .weight = (uint16_t)weight, .learn = 0});
+		}
+	}
+
+	try {
+		writePolyglotBook(argv[2], entries);
+	} catch (const runtime_error& e) {
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+
+	cout << "Read " << games << " games (" << skipped << " partially skipped), wrote " << entries.size() << " entries for " << scores.size()
+		 << " positions to " << argv[2] << endl;
+
+	return 0;
+}
\ No newline at end of file
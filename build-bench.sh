@@ -0,0 +1,3 @@
+#! /bin/bash
+
+g++ chess.cpp constants.cpp fen.cpp eval.cpp nnue.cpp pawns.cpp mapped_file.cpp arena.cpp search.cpp bench.cpp -std=c++20 -march=native -O2 -o bench
\ No newline at end of file
@@ -0,0 +1,3 @@
+#! /bin/bash
+
+g++ chess.cpp constants.cpp fen.cpp eval.cpp pawns.cpp mapped_file.cpp bitbase.cpp bitbase-gen.cpp -std=c++20 -march=native -O2 -pthread -o bitbases
\ No newline at end of file
@@ -0,0 +1,3 @@
+#! /bin/bash
+
+g++ chess.cpp constants.cpp fen.cpp eval.cpp nnue.cpp pawns.cpp mapped_file.cpp polyglot.cpp pgn.cpp book.cpp -std=c++20 -march=native -pthread -o book
\ No newline at end of file
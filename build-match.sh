@@ -0,0 +1,3 @@
+#! /bin/bash
+
+g++ chess.cpp constants.cpp fen.cpp eval.cpp nnue.cpp pawns.cpp mapped_file.cpp bitbase.cpp pgn.cpp arena.cpp search.cpp sprt.cpp match.cpp -std=c++20 -march=native -O2 -pthread -o match
\ No newline at end of file
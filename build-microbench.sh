@@ -0,0 +1,3 @@
+#! /bin/bash
+
+g++ chess.cpp constants.cpp fen.cpp eval.cpp pawns.cpp mapped_file.cpp microbench.cpp -std=c++20 -march=native -O2 -o microbench
\ No newline at end of file
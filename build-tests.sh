@@ -1,3 +1,3 @@
 #! /bin/bash
 
-g++ board.cpp chess.cpp constants.cpp tests.cpp -std=c++20 -o tests
\ No newline at end of file
+g++ board.cpp chess.cpp constants.cpp fen.cpp eval.cpp nnue.cpp pawns.cpp mapped_file.cpp polyglot.cpp bitbase.cpp packed.cpp batch.cpp pgn.cpp arena.cpp search.cpp mcts.cpp sprt.cpp tests.cpp -std=c++20 -march=native -pthread -o tests
\ No newline at end of file
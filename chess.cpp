@@ -1,13 +1,74 @@
 #include "chess.h"
 
+#include <algorithm>
+#include <bit>
+
+#include "eval.h"
+#include "fen.h"
+#include "geometry.h"
+#include "stats.h"
+
 using namespace std;
 
 int TWOS[2] = {-2, 2}, ONES[2] = {-1, 1};
 
+// every move the validators reject goes through here, so stats builds can count them
+[[noreturn]] static void illegal(const string& message) {
+	STAT_ADD(VALIDATOR_THROWS, 1);
+	throw runtime_error(message);
+}
+
 bool operator==(const Position& a, const Position& b) {
 	return a.file == b.file && a.rank == b.rank;
 }
 
+uint squareOf(const Position& pos) {
+	return (pos.rank - 1) * 8 + pos.file;
+}
+
+// what differs between the sides, as compile time constants for everything templated on the side to move
+template <Players Us>
+struct Side {
+	static constexpr Players THEM = Us == Players::WHITE ? Players::BLACK : Players::WHITE;
+	static constexpr int FORWARD = Us == Players::WHITE ? 1 : -1;
+	static constexpr uint BACK_RANK = Us == Players::WHITE ? 1 : 8;
+	static constexpr uint PAWN_RANK = Us == Players::WHITE ? 2 : 7;	// where pawns start, the only rank they can push two from
+	static constexpr uint PROMOTION_RANK = Us == Players::WHITE ? 8 : 1;
+};
+
+// every square piece attacks, sliders stopping at the first piece on occupied
+static uint64_t attacksOf(const Piece& piece, uint64_t occupied) {
+	uint square = squareOf(piece.position());
+
+	switch (piece.type()) {
+		case PieceTypes::PAWN:
+			return GEOMETRY.pawn[piece.player()][square];
+		case PieceTypes::KNIGHT:
+			return GEOMETRY.knight[square];
+		case PieceTypes::BISHOP:
+			return slidingAttacks(square, occupied, true);
+		case PieceTypes::ROOK:
+			return slidingAttacks(square, occupied, false);
+		case PieceTypes::QUEEN:
+			return slidingAttacks(square, occupied, true) | slidingAttacks(square, occupied, false);
+		case PieceTypes::KING:
+			return GEOMETRY.king[square];
+	}
+
+	return 0;
+}
+
+static bool isSlider(PieceTypes type) {
+	return type == PieceTypes::BISHOP || type == PieceTypes::ROOK || type == PieceTypes::QUEEN;
+}
+
+// the blocker closest to from, for error messages
+static Position firstBlocker(uint from, uint to, uint64_t blockers) {
+	uint square = to > from ? countr_zero(blockers) : 63 - countl_zero(blockers);
+
+	return {.file = (Files)(square % 8), .rank = square / 8 + 1};
+}
+
 string to_string(const Position& pos) {
 	string out;
 
@@ -92,7 +153,21 @@ ostream& operator<<(ostream& out, const Piece& piece) {
 	return out << name << " (" << (piece._player == Players::WHITE ? "White" : "Black") << "), " << to_string(piece._position);
 }
 
-Game::Game() : _turn(Players::WHITE), _firstMove(true), _prevMoveEnPassant(false), _shouldPromote(false), _turns(0), _halfTurnsSinceCapture(0) {
+bool PieceList::push_back(const Piece& piece) {
+	if (_size == MAX_PIECES) {
+		return false;
+	}
+
+	_pieces[_size++] = piece;
+	return true;
+}
+
+void PieceList::erase(Piece* piece) {
+	copy(piece + 1, end(), piece);
+	_size--;
+}
+
+Game::Game() : _turn(Players::WHITE), _firstMove(true), _prevMoveEnPassant(false), _shouldPromote(false), _turns(1), _halfTurnsSinceCapture(0) {
 	for (const Files file : FILES) {
 		_white.push_back(Piece('P', {.file = file, .rank = 2}));
 		_black.push_back(Piece('p', {.file = file, .rank = 7}));
@@ -115,122 +190,75 @@ Game::Game() : _turn(Players::WHITE), _firstMove(true), _prevMoveEnPassant(false
 	_black.push_back(Piece('b', {.file = Files::F, .rank = 8}));
 	_black.push_back(Piece('q', {.file = Files::D, .rank = 8}));
 	_black.push_back(Piece('k', {.file = Files::E, .rank = 8}));
-}
 
-Game::Game(const Game& other)
-	: _turn(other._turn),
-	  _firstMove(other._firstMove),
-	  _prevMove(other._prevMove),
-	  _prevMoveEnPassant(other._prevMoveEnPassant),
-	  _shouldPromote(other._shouldPromote) {
-	for (const Piece& piece : other._white) {
-		_white.push_back(Piece(piece._symbol, piece._position));
-	}
-	for (const Piece& piece : other._black) {
-		_black.push_back(Piece(piece._symbol, piece._position));
-	}
+	_resetPieceState();
+	_resetHistory();
 }
 
-Game::Game(const string& fen) : _turn(Players::WHITE), _firstMove(true), _prevMoveEnPassant(false), _shouldPromote(false) {
-	uint i = 0;
+Game::Game(const string& fen) : Game() {
+	FENError error = parseFEN(fen, *this);
 
-	Position currPos = {.file = Files::A, .rank = 8};
-	while (fen[i] != ' ') {
-		if (isdigit(fen[i])) {
-			uint numSpaces = fen[i] - '0';
+	if (error) {
+		throw runtime_error("Invalid FEN '" + fen + "': " + to_string(error) + ".");
+	}
+}
 
-			currPos.file = (Files)((int)currPos.file + numSpaces);
-		} else {
-			if (fen[i] == '/') {
-				currPos.file = Files::A;
-				currPos.rank--;
-			} else {
-				Piece piece(fen[i], currPos);
-				if (piece._type == PieceTypes::ROOK) {
-					piece._moved = true;  // prepare for later
-				}
+void Game::_toggleAttacks(const Piece& piece, uint64_t occupied, int delta) {
+	uint8_t* counts = _attackers[piece._player];
+	uint64_t squares = attacksOf(piece, occupied);
 
-				if (piece.player() == Players::WHITE) {
-					_white.push_back(piece);
-				} else {
-					_black.push_back(piece);
-				}
+	for (uint64_t bits = squares; bits; bits &= bits - 1) {
+		uint square = countr_zero(bits);
 
-				currPos.file = (Files)((int)currPos.file + 1);
-			}
+		if (!(counts[square] += delta)) {
+			_attacked[piece._player] &= ~squareBit(square);
 		}
-
-		i++;
 	}
-
-	i++;
-
-	if (fen[i] == 'b') {
-		_turn = Players::BLACK;
+	if (delta > 0) {
+		_attacked[piece._player] |= squares;
 	}
+}
 
-	i += 2;
+void Game::_resetAttacks() {
+	uint64_t occupied = _occupancy();
 
-	if (fen[i] != '-') {
-		while (fen[i] != ' ') {
-			if (isupper(fen[i])) {
-				if (fen[i] == 'K' && hasPiece({.file = Files::H, .rank = 1})) {
-					Piece& rook = _getPieceRef({.file = Files::H, .rank = 1});
+	fill(&_attackers[0][0], &_attackers[0][0] + 2 * 64, 0);
+	_attacked[Players::WHITE] = _attacked[Players::BLACK] = 0;
 
-					if (rook._type == PieceTypes::ROOK) {
-						rook._moved = false;
-					}
-				}
-				if (fen[i] == 'Q' && hasPiece({.file = Files::A, .rank = 1})) {
-					Piece& rook = _getPieceRef({.file = Files::A, .rank = 1});
+	for (const Piece& piece : _white) {
+		_toggleAttacks(piece, occupied, 1);
+	}
+	for (const Piece& piece : _black) {
+		_toggleAttacks(piece, occupied, 1);
+	}
+}
 
-					if (rook._type == PieceTypes::ROOK) {
-						rook._moved = false;
-					}
-				}
-			} else {
-				if (fen[i] == 'k' && hasPiece({.file = Files::H, .rank = 8})) {
-					Piece& rook = _getPieceRef({.file = Files::H, .rank = 8});
+template <typename Place>
+void Game::_updateAttacks(uint64_t changed, const Place& place) {
+	// a slider's attacks only change if it reaches one of the changed squares, everything else not standing on one keeps its own
+	uint64_t occupied = _occupancy(), redo = changed;
 
-					if (rook._type == PieceTypes::ROOK) {
-						rook._moved = false;
-					}
-				}
-				if (fen[i] == 'q' && hasPiece({.file = Files::A, .rank = 8})) {
-					Piece& rook = _getPieceRef({.file = Files::A, .rank = 8});
+	for (const PieceList* list : {&_white, &_black}) {
+		for (const Piece& piece : *list) {
+			uint64_t bit = squareBit(squareOf(piece._position));
 
-					if (rook._type == PieceTypes::ROOK) {
-						rook._moved = false;
-					}
-				}
+			if ((bit & changed) || (isSlider(piece._type) && (attacksOf(piece, occupied) & changed))) {
+				_toggleAttacks(piece, occupied, -1);
+				redo |= bit;
 			}
-
-			i++;
 		}
 	}
 
-	i++;
-	if (fen[i] != ' ') {
-		_prevMoveEnPassant = true;
-	}
-
-	i++;
-	string halfMoveClock;
-	while (fen[i] != ' ') {
-		halfMoveClock += fen[i];
-		i++;
-	}
-
-	_halfTurnsSinceCapture = stoi(halfMoveClock);
+	place();
+	occupied = _occupancy();
 
-	i++;
-	string fullMoveClock;
-	while (fen[i] != ' ') {
-		fullMoveClock += fen[i];
-		i++;
+	for (const PieceList* list : {&_white, &_black}) {
+		for (const Piece& piece : *list) {
+			if (squareBit(squareOf(piece._position)) & redo) {
+				_toggleAttacks(piece, occupied, 1);
+			}
+		}
 	}
-
-	_turns = stoi(fullMoveClock);
 }
 
 bool Game::move(const Move& move) {
@@ -238,9 +266,16 @@ bool Game::move(const Move& move) {
 		throw runtime_error("Select a promotion piece first.");
 	}
 
+	return _turn == Players::WHITE ? _move<Players::WHITE>(move) : _move<Players::BLACK>(move);
+}
+
+template <Players Us>
+bool Game::_move(const Move& move) {
+	constexpr Players THEM = Side<Us>::THEM;
+
 	Piece& piece = _getPieceRef(move.from);
 
-	if (piece._player != _turn) {
+	if (piece._player != Us) {
 		throw runtime_error("Moved piece does not belong to moving player.");
 	}
 	if (move.from == move.to) {
@@ -252,14 +287,14 @@ bool Game::move(const Move& move) {
 	if ((isCapture = hasPiece(move.to))) {
 		Piece destPiece = getPiece(move.to);
 
-		if (destPiece._player == _turn) {
+		if (destPiece._player == Us) {
 			throw runtime_error("Cannot move to a square occupied by same player's piece.");
 		}
 	}
 
 	switch (piece._type) {
 		case PieceTypes::PAWN:
-			_validatePawnMove(move);
+			_validatePawnMove<Us>(move);
 			break;
 		case PieceTypes::KNIGHT:
 			_validateKnightMove(move);
@@ -277,7 +312,7 @@ bool Game::move(const Move& move) {
 				try {
 					_validateBishopMove(move);
 				} catch (...) {
-					throw runtime_error("Illegal queen move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
+					illegal("Illegal queen move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
 				}
 			}
 			break;
@@ -286,12 +321,11 @@ bool Game::move(const Move& move) {
 			break;
 	}
 
-	vector<Piece>&player = _turn == Players::WHITE ? _white : _black, &other = _turn == Players::WHITE ? _black : _white;
-	Position kingPos;
+	PieceList&player = _piecesOf<Us>(), &other = _piecesOf<THEM>();
+	// where our king stands once the move is made
+	Position kingPos = move.to;
 
-	if (piece._type == PieceTypes::KING) {
-		kingPos = move.to;
-	} else {
+	if (piece._type != PieceTypes::KING) {
 		for (const Piece& piece : player) {
 			if (piece._type == PieceTypes::KING) {
 				kingPos = piece._position;
@@ -299,56 +333,75 @@ bool Game::move(const Move& move) {
 		}
 	}
 
-	if (_uncheckedBranch(move).isChecked()) {
-		throw runtime_error("Illegal move: moving into check/moving while in check.");
+	bool enPassant = piece._type == PieceTypes::PAWN && move.to.file != move.from.file && !isCapture;
+	Position enPassantPos = {.file = move.to.file, .rank = move.to.rank - Side<Us>::FORWARD};
+
+	if (_leavesInCheck<Us>(move, squareOf(kingPos), squareOf(enPassant ? enPassantPos : move.to))) {
+		illegal("Illegal move: moving into check/moving while in check.");
+	}
+
+	bool castles = piece._type == PieceTypes::KING && abs((int)move.to.file - (int)move.from.file) == 2;
+	int castleDir = (int)move.to.file - (int)move.from.file < 0 ? -1 : 1;
+	Position rookPos = {.file = castleDir == -1 ? Files::A : Files::H, .rank = Side<Us>::BACK_RANK};
+	Position rookTo = {.file = (Files)((int)move.to.file - castleDir), .rank = move.to.rank};
+
+	// every square whose occupant changes
+	uint64_t changed = squareBit(squareOf(move.from)) | squareBit(squareOf(move.to));
+	if (enPassant) {
+		changed |= squareBit(squareOf(enPassantPos));
+	}
+	if (castles) {
+		changed |= squareBit(squareOf(rookPos)) | squareBit(squareOf(rookTo));
 	}
 
 	_prevMoveEnPassant = false;
-	if (isCapture) {
-		uint capturedIdx = (uint)-1;
-		for (uint i = 0; i < other.size(); i++) {
-			if (other[i]._position == move.to) {
-				capturedIdx = i;
-			}
-		}
 
-		if (capturedIdx != (uint)-1) {
-			other.erase(other.begin() + capturedIdx);
-		} else {
-			throw runtime_error("Shit done fucked up (capture logic)");
-		}
-		_halfTurnsSinceCapture = 0;
-	} else if (piece._type == PieceTypes::PAWN && move.to.file != move.from.file && !hasPiece(move.to) &&
-			   hasPiece({.file = move.to.file, .rank = move.to.rank + (_turn == Players::WHITE ? -1 : 1)})) {
-		uint capturedIdx = (uint)-1;
-		for (uint i = 0; i < other.size(); i++) {
-			if (other[i]._position == Position{.file = move.to.file, .rank = move.to.rank + (_turn == Players::WHITE ? -1 : 1)} &&
-				other[i]._type == PieceTypes::PAWN) {
-				capturedIdx = i;
+	// the attack maps are redone around the squares that change, once everything is in place
+	_updateAttacks(changed, [&]() {
+		if (isCapture) {
+			uint capturedIdx = (uint)-1;
+			for (uint i = 0; i < other.size(); i++) {
+				if (other[i]._position == move.to) {
+					capturedIdx = i;
+				}
 			}
-		}
 
-		if (capturedIdx != (uint)-1) {
-			other.erase(other.begin() + capturedIdx);
-		} else {
-			throw runtime_error("Shit done fucked up (capture logic)");
-		}
+			if (capturedIdx != (uint)-1) {
+				_removePieceState(other[capturedIdx]);
+				other.erase(other.begin() + capturedIdx);
+			} else {
+				throw runtime_error("Shit done fucked up (capture logic)");
+			}
+			_halfTurnsSinceCapture = 0;
+		} else if (enPassant && hasPiece(enPassantPos)) {
+			uint capturedIdx = (uint)-1;
+			for (uint i = 0; i < other.size(); i++) {
+				if (other[i]._position == enPassantPos && other[i]._type == PieceTypes::PAWN) {
+					capturedIdx = i;
+				}
+			}
 
-		_prevMoveEnPassant = true;
-	}
+			if (capturedIdx != (uint)-1) {
+				_removePieceState(other[capturedIdx]);
+				other.erase(other.begin() + capturedIdx);
+			} else {
+				throw runtime_error("Shit done fucked up (capture logic)");
+			}
 
-	piece._position = move.to;
-	if (piece._type == PieceTypes::KING && abs((int)move.to.file - (int)move.from.file) == 2) {
-		// consider castling
-		int castleDir = (int)move.to.file - (int)move.from.file < 0 ? -1 : 1;
-		Position rookPos = {.file = castleDir == -1 ? Files::A : Files::H, .rank = _turn == Players::WHITE ? 1u : 8u};
-		Piece& rook = _getPieceRef(rookPos);
+			_prevMoveEnPassant = true;
+		}
 
-		Position rookTo = move.to;
-		rookTo.file = (Files)((int)rookTo.file + (castleDir == -1 ? 1 : -1));
+		_removePieceState(piece);
+		piece._position = move.to;
+		_addPieceState(piece);
+		if (castles) {
+			Piece& rook = _getPieceRef(rookPos);
 
-		rook._position = rookTo;
-	}
+			_removePieceState(rook);
+			rook._position = rookTo;
+			_addPieceState(rook);
+		}
+	});
 
 	_prevMove = move;
 
@@ -359,25 +412,30 @@ bool Game::move(const Move& move) {
 		piece._moved = true;
 	}
 
-	if (_turn == Players::BLACK) {
+	if constexpr (Us == Players::BLACK) {
 		_turns++;
 	}
 
-	if (!isCapture) {
+	// pawn moves can't be undone either, so they reset the clock just like captures
+	if (piece._type == PieceTypes::PAWN) {
+		_halfTurnsSinceCapture = 0;
+	} else if (!isCapture) {
 		_halfTurnsSinceCapture++;
 	}
 
-	if (piece._type == PieceTypes::PAWN && move.to.rank == (_turn == Players::WHITE ? 8 : 1)) {
+	if (piece._type == PieceTypes::PAWN && move.to.rank == Side<Us>::PROMOTION_RANK) {
 		_shouldPromote = true;
 		return true;
 	} else {
-		_turn = (_turn == Players::WHITE ? Players::BLACK : Players::WHITE);
+		_turn = THEM;
+		_recordPosition();
 
 		return false;
 	}
 }
 
 Game Game::branch(const Move& move) const {
+	STAT_ADD(BRANCHES, 1);
 	Game future(*this);
 
 	try {
@@ -391,19 +449,21 @@ Game Game::branch(const Move& move) const {
 	}
 }
 
-Game Game::_uncheckedBranch(const Move& move) const {
-	Game future(*this);
+template <Players Us>
+bool Game::_leavesInCheck(const Move& move, uint king, uint captured) const {
+	STAT_ADD(CHECK_TESTS, 1);
 
-	try {
-		Piece& piece = future._getPieceRef(move.from);
-		piece._position = move.to;
+	// worked out on the occupancy after the move instead of on a copy, leaving out whatever gets captured (otherwise capturing
+	// a checking piece still looks like check)
+	uint64_t occupied = (_occupancy() & ~squareBit(squareOf(move.from)) & ~squareBit(captured)) | squareBit(squareOf(move.to));
 
-		return future;
-	} catch (const runtime_error& err) {
-		throw runtime_error("Branching error: move failed with '" + string(err.what()) + "'");
-	} catch (...) {
-		throw runtime_error("Branching error: move failed with unknown error.");
+	for (const Piece& opponentPiece : _piecesOf<Side<Us>::THEM>()) {
+		if (squareOf(opponentPiece._position) != captured && (attacksOf(opponentPiece, occupied) & squareBit(king))) {
+			return true;
+		}
 	}
+
+	return false;
 }
 
 Game Game::branchPromote(const Position& pos, PieceTypes to) const {
@@ -421,37 +481,67 @@ Game Game::branchPromote(const Position& pos, PieceTypes to) const {
 }
 
 vector<Move> Game::getAvailableMoves() const {
+	STAT_TIMER(TIME_GET_AVAILABLE_MOVES);
+
+	MoveList candidates;
+	_candidateMoves(candidates);
+
+	// validate with futures (not with move because that would modify things if a move succeeds)
 	vector<Move> out;
+	for (const Move& move : candidates) {
+		try {
+			branch(move);
+			out.push_back(move);
+		} catch (...) {
+			continue;
+		}
+	}
+
+	return out;
+}
 
-	const vector<Piece>& player = _turn == Players::WHITE ? _white : _black;
+void Game::_candidateMoves(MoveList& out) const {
+	_turn == Players::WHITE ? _candidateMoves<Players::WHITE>(out) : _candidateMoves<Players::BLACK>(out);
+}
+
+template <Players Us>
+void Game::_candidateMoves(MoveList& out) const {
+	STAT_ADD(MOVEGEN_CALLS, 1);
+	out.clear();
+
+	const PieceList& player = _piecesOf<Us>();
 
-	// first, naively generate available moves based only on piece location
+	// an empty square a pawn may still capture onto
+	Position enPassant;
+	bool canEnPassant = enPassantTarget(enPassant);
+
+	// naively generate available moves based only on piece location
 	for (const Piece& piece : player) {
 		switch (piece._type) {
 			case PieceTypes::PAWN:
-				if (piece._position.rank == (_turn == Players::WHITE ? 2 : 7) &&
-					!hasPiece({.file = piece._position.file, .rank = piece._position.rank + (_turn == Players::WHITE ? 2 : -2)})) {
+				if (piece._position.rank == Side<Us>::PAWN_RANK &&
+					!hasPiece({.file = piece._position.file, .rank = piece._position.rank + 2 * Side<Us>::FORWARD})) {
 					out.push_back(
-						{.from = piece._position, .to = {.file = piece._position.file, .rank = piece._position.rank + (_turn == Players::WHITE ? 2 : -2)}});
+						{.from = piece._position, .to = {.file = piece._position.file, .rank = piece._position.rank + 2 * Side<Us>::FORWARD}});
 				}
-				if (!hasPiece({.file = piece._position.file, .rank = piece._position.rank + (_turn == Players::WHITE ? 1 : -1)})) {
+				if (!hasPiece({.file = piece._position.file, .rank = piece._position.rank + Side<Us>::FORWARD})) {
 					out.push_back(
-						{.from = piece._position, .to = {.file = piece._position.file, .rank = piece._position.rank + (_turn == Players::WHITE ? 1 : -1)}});
+						{.from = piece._position, .to = {.file = piece._position.file, .rank = piece._position.rank + Side<Us>::FORWARD}});
 				}
 
 				if (piece._position.file != Files::A) {
 					Position captureLeft = {.file = (Files)((int)piece._position.file - 1),
-											.rank = piece._position.rank + (_turn == Players::WHITE ? 1 : -1)};
+											.rank = piece._position.rank + Side<Us>::FORWARD};
 
-					if (hasPiece(captureLeft) && getPiece(captureLeft)._player != _turn) {
+					if ((hasPiece(captureLeft) && getPiece(captureLeft)._player != Us) || (canEnPassant && captureLeft == enPassant)) {
 						out.push_back({.from = piece._position, .to = captureLeft});
 					}
 				}
 				if (piece._position.file != Files::H) {
 					Position captureRight = {.file = (Files)((int)piece._position.file + 1),
-											 .rank = piece._position.rank + (_turn == Players::WHITE ? 1 : -1)};
+											 .rank = piece._position.rank + Side<Us>::FORWARD};
 
-					if (hasPiece(captureRight) && getPiece(captureRight)._player != _turn) {
+					if ((hasPiece(captureRight) && getPiece(captureRight)._player != Us) || (canEnPassant && captureRight == enPassant)) {
 						out.push_back({.from = piece._position, .to = captureRight});
 					}
 				}
@@ -464,7 +554,7 @@ vector<Move> Game::getAvailableMoves() const {
 						if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 							Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-							if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+							if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 								out.push_back({.from = piece._position, .to = newPos});
 							}
 						}
@@ -478,7 +568,7 @@ vector<Move> Game::getAvailableMoves() const {
 						if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 							Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-							if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+							if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 								out.push_back({.from = piece._position, .to = newPos});
 							}
 						}
@@ -493,7 +583,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -506,7 +596,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -519,7 +609,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -532,7 +622,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -548,7 +638,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -561,7 +651,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -574,7 +664,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -587,7 +677,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -602,7 +692,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -615,7 +705,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -628,7 +718,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -641,7 +731,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -654,7 +744,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -667,7 +757,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -680,7 +770,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -693,7 +783,7 @@ vector<Move> Game::getAvailableMoves() const {
 					if (newFile >= 0 && newFile < 8 && newRank >= 1 && newRank <= 8) {
 						Position newPos = {.file = (Files)newFile, .rank = (uint)newRank};
 
-						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn)) {
+						if (!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us)) {
 							out.push_back({.from = piece._position, .to = newPos});
 						}
 					} else {
@@ -706,73 +796,73 @@ vector<Move> Game::getAvailableMoves() const {
 				Position newPos = {.file = (Files)((int)piece._position.file - 1), .rank = piece._position.rank + 1};
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				newPos.file = (Files)((int)newPos.file + 1);
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				newPos.file = (Files)((int)newPos.file + 1);
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				newPos.rank--;
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				newPos.rank--;
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				newPos.file = (Files)((int)newPos.file - 1);
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				newPos.file = (Files)((int)newPos.file - 1);
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				newPos.rank++;
 
 				if (newPos.file >= 0 && newPos.file < 8 && newPos.rank >= 1 && newPos.rank <= 8 &&
-					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != _turn))) {
+					(!hasPiece(newPos) || (hasPiece(newPos) && getPiece(newPos)._player != Us))) {
 					out.push_back({.from = piece._position, .to = newPos});
 				}
 
 				// account for castling
 				if (!piece._moved) {
-					if (hasPiece({.file = Files::H, .rank = _turn == Players::WHITE ? 1u : 8u})) {
-						Piece kingRook = getPiece({.file = Files::H, .rank = _turn == Players::WHITE ? 1u : 8u});
+					if (hasPiece({.file = Files::H, .rank = Side<Us>::BACK_RANK})) {
+						Piece kingRook = getPiece({.file = Files::H, .rank = Side<Us>::BACK_RANK});
 
 						if (!kingRook._moved) {
-							out.push_back({.from = piece._position, .to = {.file = Files::G, .rank = _turn == Players::WHITE ? 1u : 8u}});
+							out.push_back({.from = piece._position, .to = {.file = Files::G, .rank = Side<Us>::BACK_RANK}});
 						}
 					}
-					if (hasPiece({.file = Files::A, .rank = _turn == Players::WHITE ? 1u : 8u})) {
-						Piece queenRook = getPiece({.file = Files::A, .rank = _turn == Players::WHITE ? 1u : 8u});
+					if (hasPiece({.file = Files::A, .rank = Side<Us>::BACK_RANK})) {
+						Piece queenRook = getPiece({.file = Files::A, .rank = Side<Us>::BACK_RANK});
 
 						if (!queenRook._moved) {
-							out.push_back({.from = piece._position, .to = {.file = Files::C, .rank = _turn == Players::WHITE ? 1u : 8u}});
+							out.push_back({.from = piece._position, .to = {.file = Files::C, .rank = Side<Us>::BACK_RANK}});
 						}
 					}
 				}
@@ -780,17 +870,7 @@ vector<Move> Game::getAvailableMoves() const {
 		}
 	}
 
-	// then, validate with futures (not with move because that would modify things if a move succeeds)
-	for (uint i = 0; i < out.size(); i++) {
-		try {
-			branch(out[i]);
-		} catch (...) {
-			out.erase(out.begin() + i);
-			i--;
-		}
-	}
-
-	return out;
+	STAT_ADD(MOVES_GENERATED, out.size());
 }
 
 uint Game::materiel(Players player) const {
@@ -827,7 +907,8 @@ void Game::promote(const Position& pos, PieceTypes to) {
 	}
 
 	// TODO: consider moving this to private promotion method on piece
-	piece._type = to;
+	_removePieceState(piece);
+	_updateAttacks(squareBit(squareOf(pos)), [&]() { piece._type = to; });
 	switch (to) {
 		case PieceTypes::KNIGHT:
 			piece._symbol = _turn == Players::WHITE ? 'N' : 'n';
@@ -844,10 +925,11 @@ void Game::promote(const Position& pos, PieceTypes to) {
 		default:
 			throw runtime_error("Shit done fucked up (promotion)");
 	}
-	piece._value = valueOf(piece._type);
+	_addPieceState(piece);
 
 	_turn = (_turn == Players::WHITE ? Players::BLACK : Players::WHITE);
 	_shouldPromote = false;
+	_recordPosition();
 }
 
 Piece Game::getPiece(const Position& pos) const {
@@ -871,161 +953,66 @@ bool Game::isChecked() const {
 }
 
 bool Game::isChecked(Players player) const {
-	const vector<Piece>&thisPlayer = player == Players::WHITE ? _white : _black, &other = player == Players::WHITE ? _black : _white;
-	Position kingPos;
+	return player == Players::WHITE ? _isChecked<Players::WHITE>() : _isChecked<Players::BLACK>();
+}
 
-	for (const Piece& piece : thisPlayer) {
-		if (piece._type == PieceTypes::KING) {
-			kingPos = piece._position;
-		}
-	}
+template <Players Us>
+bool Game::_isChecked() const {
+	STAT_ADD(CHECK_TESTS, 1);
+	STAT_TIMER(TIME_IS_CHECKED);
 
-	for (const Piece& opponentPiece : other) {
-		switch (opponentPiece._type) {
-			case PieceTypes::PAWN:
-				try {
-					// TODO: no idea if en passant is an edge case here? (i think it shouldnt)
-					_validatePawnMove({.from = opponentPiece._position, .to = kingPos});
-					break;	// normal breakout of switch block, triggering "trap"
-				} catch (...) {
-					continue;  // skips the "trap" at the bottom of each iteration
-				}
-			case PieceTypes::KNIGHT:
-				try {
-					_validateKnightMove({.from = opponentPiece._position, .to = kingPos});
-					break;
-				} catch (...) {
-					continue;
-				}
-			case PieceTypes::BISHOP:
-				try {
-					_validateBishopMove({.from = opponentPiece._position, .to = kingPos});
-					break;
-				} catch (...) {
-					continue;
-				}
-			case PieceTypes::ROOK:
-				try {
-					_validateRookMove({.from = opponentPiece._position, .to = kingPos});
-					break;
-				} catch (...) {
-					continue;
-				}
-			case PieceTypes::QUEEN:
-				try {
-					_validateRookMove({.from = opponentPiece._position, .to = kingPos});
-					break;
-				} catch (...) {
-					try {
-						_validateBishopMove({.from = opponentPiece._position, .to = kingPos});
-						break;
-					} catch (...) {
-						continue;
-					}
-				}
-			case PieceTypes::KING:
-				try {
-					_validateKingMove({.from = opponentPiece._position, .to = kingPos});
-					break;
-				} catch (...) {
-					continue;
-				}
-		}
+	uint kingSquare = 0;
 
-		return true;
+	for (const Piece& piece : _piecesOf<Us>()) {
+		if (piece._type == PieceTypes::KING) {
+			kingSquare = squareOf(piece._position);
+		}
 	}
 
-	return false;
+	return _attacked[Side<Us>::THEM] & squareBit(kingSquare);
 }
 
-string Game::dumpFEN() const {
-	string fen;
-
-	for (uint rank = 8; rank >= 1; rank--) {
-		for (Files file : FILES) {
-			if (hasPiece({.file = file, .rank = rank})) {
-				fen += getPiece({.file = file, .rank = rank})._symbol;
-			} else {
-				if (fen.back() >= '0' && fen.back() <= '9') {
-					fen.back()++;
-				} else {
-					fen += '1';
-				}
-			}
-		}
-
-		fen += "/";
+GameStates Game::status() const {
+	if (_shouldPromote) {
+		throw runtime_error("Select a promotion piece first.");
 	}
 
-	fen.pop_back();
-	fen += ' ';
-	fen += _turn == Players::WHITE ? 'w' : 'b';
-
-	fen += ' ';
-	bool wKingCastle = false;
-	for (const Piece& piece : _white) {
-		if (piece._type == PieceTypes::KING) {
-			wKingCastle = !piece._moved;
-			break;
-		}
+	// a repeated or dead position can't be mate, so the cheap checks go first
+	if (_repetitions >= 2) {
+		return GameStates::REPETITION;
 	}
-
-	if (wKingCastle) {
-		for (const Piece& piece : _white) {
-			if (piece._type == PieceTypes::ROOK && !piece._moved) {
-				if (piece._position == Position{.file = Files::A, .rank = 1}) {
-					fen += 'K';
-				} else if (piece._position == Position{.file = Files::H, .rank = 1}) {
-					fen += 'Q';
-				} else {
-					throw runtime_error("Piece state done fucked up");
-				}
-			}
-		}
+	if (_insufficientMaterial()) {
+		return GameStates::INSUFFICIENT_MATERIAL;
 	}
 
-	bool bKingCastle = false;
-	for (const Piece& piece : _black) {
-		if (piece._type == PieceTypes::KING) {
-			bKingCastle = !piece._moved;
-			break;
-		}
-	}
+	MoveList candidates;
+	_candidateMoves(candidates);
 
-	if (bKingCastle) {
-		for (const Piece& piece : _black) {
-			if (piece._type == PieceTypes::ROOK && !piece._moved) {
-				if (piece._position == Position{.file = Files::A, .rank = 8}) {
-					fen += 'k';
-				} else if (piece._position == Position{.file = Files::H, .rank = 8}) {
-					fen += 'q';
-				} else {
-					throw runtime_error("Piece state done fucked up");
-				}
-			}
+	bool hasMove = false;
+	for (const Move& move : candidates) {
+		try {
+			branch(move);
+			hasMove = true;
+			break;
+		} catch (...) {
+			continue;
 		}
 	}
 
-	if (fen.back() == ' ') {
-		fen += "- ";
+	if (!hasMove) {
+		return isChecked() ? GameStates::CHECKMATE : GameStates::STALEMATE;
 	}
-
-	if (_prevMoveEnPassant) {
-		string moveStr = to_string(_prevMove.to);
-		moveStr[0] = tolower(moveStr[0]);
-
-		fen += moveStr;
-	} else {
-		fen += '-';
+	if (_halfTurnsSinceCapture >= 100) {
+		return GameStates::FIFTY_MOVES;
 	}
 
-	fen += ' ';
-	fen += to_string(_halfTurnsSinceCapture);
+	return GameStates::IN_PROGRESS;
+}
 
-	fen += ' ';
-	fen += to_string(_turns);
+string Game::dumpFEN() const {
+	char fen[MAX_FEN_LENGTH];
 
-	return fen;
+	return string(fen, writeFEN(*this, fen));
 }
 
 Piece& Game::_getPieceRef(const Position& pos) {
@@ -1044,6 +1031,19 @@ Piece& Game::_getPieceRef(const Position& pos) {
 	throw runtime_error("No piece at position " + to_string(pos));
 }
 
+uint64_t Game::_occupancy() const {
+	uint64_t occupied = 0;
+
+	for (const Piece& piece : _white) {
+		occupied |= squareBit(squareOf(piece._position));
+	}
+	for (const Piece& piece : _black) {
+		occupied |= squareBit(squareOf(piece._position));
+	}
+
+	return occupied;
+}
+
 bool Game::hasPiece(const Position& pos) const {
 	for (const Piece& piece : _white) {
 		if (piece._position == pos) {
@@ -1060,6 +1060,10 @@ bool Game::hasPiece(const Position& pos) const {
 	return false;
 }
 
+const PieceList& Game::pieces(Players player) const {
+	return player == Players::WHITE ? _white : _black;
+}
+
 Players Game::turn() const {
 	return _turn;
 }
@@ -1067,125 +1071,219 @@ bool Game::shouldPromote() const {
 	return _shouldPromote;
 }
 
-Game& Game::operator=(const Game& other) {
-	_turn = other._turn;
-	_firstMove = other._firstMove;
-	_prevMove = other._prevMove;
-	_shouldPromote = other._shouldPromote;
+bool Game::canCastle(Players player, bool kingSide) const {
+	uint backRank = player == Players::WHITE ? 1 : 8;
+	bool kingReady = false, rookReady = false;
+
+	for (const Piece& piece : player == Players::WHITE ? _white : _black) {
+		if (piece._type == PieceTypes::KING && piece._position == Position{.file = Files::E, .rank = backRank} && !piece._moved) {
+			kingReady = true;
+		} else if (piece._type == PieceTypes::ROOK && piece._position == Position{.file = kingSide ? Files::H : Files::A, .rank = backRank} &&
+				   !piece._moved) {
+			rookReady = true;
+		}
+	}
+
+	return kingReady && rookReady;
+}
+
+bool Game::enPassantTarget(Position& target) const {
+	if (_firstMove || !hasPiece(_prevMove.to)) {
+		return false;
+	}
+
+	Piece mover = getPiece(_prevMove.to);
+	if (mover._type != PieceTypes::PAWN || abs((int)_prevMove.to.rank - (int)_prevMove.from.rank) != 2) {
+		return false;
+	}
+
+	target = {.file = _prevMove.to.file, .rank = (_prevMove.from.rank + _prevMove.to.rank) / 2};
+
+	return true;
+}
+
+void Game::_addPieceState(const Piece& piece) {
+	_mgScore[piece._player] += mgValue(piece._type, piece._player, piece._position);
+	_egScore[piece._player] += egValue(piece._type, piece._player, piece._position);
+	_phase += phaseOf(piece._type);
+	_pieceKey ^= ZOBRIST.pieces[piece._player][piece._type][squareOf(piece._position)];
 
-	for (const Piece& piece : other._white) {
-		_white.push_back(Piece(piece._symbol, piece._position));
+	if (piece._type == PieceTypes::PAWN) {
+		_pawnKey ^= ZOBRIST.pieces[piece._player][PieceTypes::PAWN][squareOf(piece._position)];
 	}
-	for (const Piece& piece : other._black) {
-		_black.push_back(Piece(piece._symbol, piece._position));
+}
+
+void Game::_removePieceState(const Piece& piece) {
+	_mgScore[piece._player] -= mgValue(piece._type, piece._player, piece._position);
+	_egScore[piece._player] -= egValue(piece._type, piece._player, piece._position);
+	_phase -= phaseOf(piece._type);
+	_pieceKey ^= ZOBRIST.pieces[piece._player][piece._type][squareOf(piece._position)];
+
+	if (piece._type == PieceTypes::PAWN) {
+		_pawnKey ^= ZOBRIST.pieces[piece._player][PieceTypes::PAWN][squareOf(piece._position)];
+	}
+}
+
+void Game::_resetPieceState() {
+	_mgScore[Players::WHITE] = _mgScore[Players::BLACK] = 0;
+	_egScore[Players::WHITE] = _egScore[Players::BLACK] = 0;
+	_phase = 0;
+	_pawnKey = _pieceKey = 0;
+
+	for (const Piece& piece : _white) {
+		_addPieceState(piece);
+	}
+	for (const Piece& piece : _black) {
+		_addPieceState(piece);
+	}
+
+	_resetAttacks();
+}
+
+void Game::_recordPosition() {
+	_key = _pieceKey;
+
+	if (_turn == Players::BLACK) {
+		_key ^= ZOBRIST.turn;
+	}
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		for (const bool kingSide : {true, false}) {
+			if (canCastle(player, kingSide)) {
+				_key ^= ZOBRIST.castling[player][kingSide];
+			}
+		}
+	}
+
+	// only count the en passant square when a pawn can actually take, otherwise a double push would never repeat
+	Position target;
+	if (enPassantTarget(target)) {
+		for (const Piece& piece : _turn == Players::WHITE ? _white : _black) {
+			if (piece._type == PieceTypes::PAWN && piece._position.rank == _prevMove.to.rank &&
+				abs((int)piece._position.file - (int)_prevMove.to.file) == 1) {
+				_key ^= ZOBRIST.enPassant[target.file];
+				break;
+			}
+		}
+	}
+
+	// same side to move means an even distance, and nothing before the last capture or pawn move can come back
+	uint reversible = min((uint)_halfTurnsSinceCapture, _historySize);
+	_repetitions = 0;
+	for (uint back = 4; back <= reversible; back += 2) {
+		if (_keyHistory[(_historyEnd + KEY_HISTORY_SIZE - back) % KEY_HISTORY_SIZE] == _key) {
+			_repetitions++;
+		}
+	}
+
+	_keyHistory[_historyEnd] = _key;
+	_historyEnd = (_historyEnd + 1) % KEY_HISTORY_SIZE;
+	_historySize = min(_historySize + 1, KEY_HISTORY_SIZE);
+}
+
+void Game::_resetHistory() {
+	_historyEnd = _historySize = 0;
+	_recordPosition();
+}
+
+bool Game::_insufficientMaterial() const {
+	// anything with 5+ pieces on the board still has mating material (handles almost every call)
+	if (_white.size() + _black.size() > 4) {
+		return false;
+	}
+
+	uint minors = 0, bishopSquareColors[2] = {0, 0};
+	for (const PieceList* pieces : {&_white, &_black}) {
+		for (const Piece& piece : *pieces) {
+			switch (piece._type) {
+				case PieceTypes::KING:
+					break;
+				case PieceTypes::KNIGHT:
+					minors++;
+					break;
+				case PieceTypes::BISHOP:
+					minors++;
+					bishopSquareColors[(piece._position.file + piece._position.rank) % 2]++;
+					break;
+				default:
+					return false;
+			}
+		}
 	}
 
-	return *this;
+	// lone kings, a single minor piece, or bishops that all live on one color
+	return minors <= 1 || bishopSquareColors[0] == minors || bishopSquareColors[1] == minors;
 }
 
+template <Players Us>
 void Game::_validatePawnMove(const Move& move) const {
+	constexpr int FORWARD = Side<Us>::FORWARD;
+
 	Piece piece = getPiece(move.from);
 
 	bool isCapture =
 		hasPiece(move.to) || (!_firstMove && (hasPiece(_prevMove.to) && getPiece(_prevMove.to)._type == PieceTypes::PAWN &&
-											  _prevMove.from.rank == (_turn == Players::WHITE ? 7 : 2) && _prevMove.to.file == move.to.file &&
-											  _prevMove.to.rank == move.to.rank + (_turn == Players::WHITE ? -1 : 1)));	 // this ugly logic is en passant
+											  _prevMove.from.rank == Side<Side<Us>::THEM>::PAWN_RANK && _prevMove.to.file == move.to.file &&
+											  (int)_prevMove.to.rank == (int)move.to.rank - FORWARD));	// this ugly logic is en passant
 
-	if (isCapture && (move.to.rank != (_turn == Players::WHITE ? move.from.rank + 1 : move.from.rank - 1) ||
+	if (isCapture && ((int)move.to.rank != (int)move.from.rank + FORWARD ||
 					  (move.to.file != move.from.file + 1 &&
 					   move.to.file != move.from.file - 1))) {	// shouldn't have to worry about overflow because it won't be equal anyway
-		throw runtime_error("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) + ": captures must be diagonal.");
+		illegal("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) + ": captures must be diagonal.");
 	} else if (!isCapture) {
 		if (move.to.file != move.from.file) {
-			throw runtime_error("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) + ": normal moves must be straight.");
+			illegal("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) + ": normal moves must be straight.");
 		}
 
-		if (piece._position.rank == (_turn == Players::WHITE ? 2 : 7)) {
-			// splitting up cases to make logic clearer
-			if (_turn == Players::WHITE && (move.to.rank < move.from.rank || move.to.rank > move.from.rank + 2)) {
-				throw runtime_error("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) +
-									": normal move from starting position must be to one of the 2 tiles directly forwards.");
-			} else if (_turn == Players::BLACK && (move.to.rank > move.from.rank || move.to.rank < move.from.rank - 2)) {
-				throw runtime_error("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) +
-									": normal move from starting position must be to one of the 2 tiles directly forwards.");
-			}
-		} else {
-			if (_turn == Players::WHITE && (move.to.rank < move.from.rank || move.to.rank > move.from.rank + 1)) {
-				throw runtime_error("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) +
-									": normal move not from starting position must be to tile directly forwards.");
-			} else if (_turn == Players::BLACK && (move.to.rank > move.from.rank || move.to.rank < move.from.rank - 1)) {
-				throw runtime_error("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) +
-									": normal move not from starting position must be to tile directly forwards.");
+		if (abs((int)move.to.rank - (int)move.from.rank) == 2 && hasPiece({.file = move.from.file, .rank = (move.from.rank + move.to.rank) / 2})) {
+			illegal("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) + ": blocked by piece in front.");
+		}
+
+		// ranks advanced, negative going backwards
+		int steps = ((int)move.to.rank - (int)move.from.rank) * FORWARD;
+
+		if (piece._position.rank == Side<Us>::PAWN_RANK) {
+			if (steps < 0 || steps > 2) {
+				illegal("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) +
+						": normal move from starting position must be to one of the 2 tiles directly forwards.");
 			}
+		} else if (steps < 0 || steps > 1) {
+			illegal("Illegal pawn move from " + to_string(move.from) + " to " + to_string(move.to) +
+					": normal move not from starting position must be to tile directly forwards.");
 		}
 	}
 }
 
 void Game::_validateKnightMove(const Move& move) const {
-	int diffRank = abs((int)move.to.rank - (int)move.from.rank);
+	uint from = squareOf(move.from), to = squareOf(move.to);
 
-	if (diffRank > 2 || diffRank < 1) {
-		throw runtime_error("Illegal knight move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
-	}
-
-	int diffFile = abs((int)move.to.file - (int)move.from.file);
-
-	if (diffFile > 2 || diffFile < 1) {
-		throw runtime_error("Illegal knight move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
-	}
-
-	if (diffRank == diffFile) {
-		throw runtime_error("Illegal knight move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
+	if (GEOMETRY.chebyshev[from][to] != 2 || GEOMETRY.manhattan[from][to] != 3) {
+		illegal("Illegal knight move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
 	}
 }
 
 void Game::_validateBishopMove(const Move& move) const {
-	int diffRank = abs((int)move.to.rank - (int)move.from.rank), diffFile = abs((int)move.to.file - (int)move.from.file);
+	uint from = squareOf(move.from), to = squareOf(move.to);
 
-	if (diffRank != diffFile) {
-		throw runtime_error("Illegal bishop move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
+	if (!(GEOMETRY.diagonal[from] & squareBit(to))) {
+		illegal("Illegal bishop move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
 	}
 
-	int rankDir = ((int)move.to.rank - (int)move.from.rank) < 0 ? -1 : 1, fileDir = ((int)move.to.file - (int)move.from.file) < 0 ? -1 : 1;
-
-	for (uint i = 1; i < (uint)diffRank; i++) {
-		uint file = move.from.file + fileDir * i, rank = move.from.rank + rankDir * i;
-		Position pos = {.file = (Files)file, .rank = rank};
-
-		if (hasPiece(pos)) {
-			throw runtime_error("Illegal bishop move from " + to_string(move.from) + " to " + to_string(move.to) + ": intervening piece on " +
-								to_string(pos) + ".");
-		}
+	if (uint64_t blockers = GEOMETRY.between[from][to] & _occupancy()) {
+		illegal("Illegal bishop move from " + to_string(move.from) + " to " + to_string(move.to) + ": intervening piece on " +
+				to_string(firstBlocker(from, to, blockers)) + ".");
 	}
 }
 
 void Game::_validateRookMove(const Move& move) const {
-	if (move.to.file != move.from.file && move.to.rank != move.from.rank) {
-		throw runtime_error("Illegal rook move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
-	}
+	uint from = squareOf(move.from), to = squareOf(move.to);
 
-	if (move.to.file != move.from.file) {
-		int fileDir = ((int)move.to.file - (int)move.from.file) < 0 ? -1 : 1;
-
-		for (uint file = move.from.file + fileDir; file != move.to.file; file += fileDir) {
-			Position pos = {.file = (Files)file, .rank = move.from.rank};
-
-			if (hasPiece(pos)) {
-				throw runtime_error("Illegal rook move from " + to_string(move.from) + " to " + to_string(move.to) + ": intervening piece on " +
-									to_string(pos) + ".");
-			}
-		}
-	} else {
-		int rankDir = ((int)move.to.rank - (int)move.from.rank) < 0 ? -1 : 1;
-
-		for (uint rank = move.from.rank + rankDir; rank != move.to.rank; rank += rankDir) {
-			Position pos = {.file = move.from.file, .rank = rank};
+	if (!(GEOMETRY.orthogonal[from] & squareBit(to))) {
+		illegal("Illegal rook move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
+	}
 
-			if (hasPiece(pos)) {
-				throw runtime_error("Illegal rook move from " + to_string(move.from) + " to " + to_string(move.to) + ": intervening piece on " +
-									to_string(pos) + ".");
-			}
-		}
+	if (uint64_t blockers = GEOMETRY.between[from][to] & _occupancy()) {
+		illegal("Illegal rook move from " + to_string(move.from) + " to " + to_string(move.to) + ": intervening piece on " +
+				to_string(firstBlocker(from, to, blockers)) + ".");
 	}
 }
 
@@ -1194,7 +1292,7 @@ void Game::_validateKingMove(const Move& move) const {
 	int diffRank = abs((int)move.to.rank - (int)move.from.rank), diffFile = abs((int)move.to.file - (int)move.from.file);
 
 	if (diffRank > 1) {
-		throw runtime_error("Illegal king move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
+		illegal("Illegal king move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
 	}
 
 	if (diffFile > 1) {
@@ -1203,70 +1301,21 @@ void Game::_validateKingMove(const Move& move) const {
 		Piece king = getPiece(move.from), rook = getPiece({.file = castleDir == -1 ? Files::A : Files::H, .rank = _turn == Players::WHITE ? 1u : 8u});
 
 		if (diffFile == 2 && king._type == PieceTypes::KING && !king._moved && rook._type == PieceTypes::ROOK && !rook._moved) {
-			for (uint file = king._position.file + castleDir; file < rook._position.file; file += castleDir) {
-				if (hasPiece({.file = (Files)file, .rank = _turn == Players::WHITE ? 1u : 8u})) {
-					throw runtime_error("Illegal king move: castling through piece.");
-				}
+			if (GEOMETRY.between[squareOf(king._position)][squareOf(rook._position)] & _occupancy()) {
+				illegal("Illegal king move: castling through piece.");
 			}
 
-			const vector<Piece>& other = _turn == Players::WHITE ? _black : _white;
-
-			for (const Piece& opponentPiece : other) {
-				switch (opponentPiece._type) {
-					case PieceTypes::PAWN:
-						try {
-							// TODO: no idea if en passant is an edge case here? (i think it shouldnt)
-							_validatePawnMove({.from = opponentPiece._position, .to = move.from});
-							break;	// breaks out of switch block, triggering "trap"
-						} catch (...) {
-							continue;  // skips the "trap" at the bottom of each iteration
-						}
-					case PieceTypes::KNIGHT:
-						try {
-							_validateKnightMove({.from = opponentPiece._position, .to = move.from});
-							break;
-						} catch (...) {
-							continue;
-						}
-					case PieceTypes::BISHOP:
-						try {
-							_validateBishopMove({.from = opponentPiece._position, .to = move.from});
-							break;
-						} catch (...) {
-							continue;
-						}
-					case PieceTypes::ROOK:
-						try {
-							_validateRookMove({.from = opponentPiece._position, .to = move.from});
-							break;
-						} catch (...) {
-							continue;
-						}
-					case PieceTypes::QUEEN:
-						try {
-							_validateRookMove({.from = opponentPiece._position, .to = move.from});
-							break;
-						} catch (...) {
-							try {
-								_validateBishopMove({.from = opponentPiece._position, .to = move.from});
-								break;
-							} catch (...) {
-								continue;
-							}
-						}
-					case PieceTypes::KING:
-						try {
-							_validateKingMove({.from = opponentPiece._position, .to = move.from});
-							break;
-						} catch (...) {
-							continue;
-						}
-				}
+			// the square the king crosses can't be attacked either (landing in check is caught like any other move)
+			Position crossed = {.file = (Files)(move.from.file + castleDir), .rank = move.from.rank};
+			if (_attacked[_turn == Players::WHITE ? Players::BLACK : Players::WHITE] & squareBit(squareOf(crossed))) {
+				illegal("Illegal king move: castling through check.");
+			}
 
-				throw runtime_error("Illegal king move: castling out of check.");
+			if (isChecked(_turn)) {
+				illegal("Illegal king move: castling out of check.");
 			}
 		} else {
-			throw runtime_error("Illegal king move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
+			illegal("Illegal king move from " + to_string(move.from) + " to " + to_string(move.to) + ".");
 		}
 	}
 }
\ No newline at end of file
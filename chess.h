@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "constants.h"
@@ -14,6 +16,9 @@ struct Position {
 
 bool operator==(const Position& a, const Position& b);
 
+// 0 (A1) to 63 (H8), rank-major
+uint squareOf(const Position& pos);
+
 std::string to_string(const Position& pos);
 
 struct Move {
@@ -21,8 +26,15 @@ struct Move {
 	Position to;
 };
 
+class Game;
+class Searcher;
+class MCTS;
+struct FENError;
+struct PackedPosition;
+
 class Piece {
 public:
+	Piece() = default;
 	Piece(char symbol, Position position);
 
 	const Position& position() const;
@@ -34,12 +46,13 @@ public:
 	char symbol() const;
 
 	friend class Game;
+	friend FENError parseFEN(std::string_view fen, Game& game);
+	friend void unpackPosition(const PackedPosition& packed, Game& game);
 	friend std::ostream& operator<<(std::ostream& out, const Piece& piece);
 
 private:
 	Position _position;
 	PieceTypes _type;
-	uint _value;
 	Players _player;
 	char _symbol;
 	bool _moved;
@@ -47,10 +60,74 @@ private:
 
 std::ostream& operator<<(std::ostream& out, const Piece& piece);
 
+// promotions only ever replace pawns, so a side never has more than its starting 16 pieces
+const uint MAX_PIECES = 16;
+
+// a side's pieces stored inline in a fixed array (vector-like interface), which keeps Game a flat, trivially copyable struct
+class PieceList {
+public:
+	PieceList() : _size(0) {}
+
+	Piece* begin() { return _pieces; }
+	Piece* end() { return _pieces + _size; }
+	const Piece* begin() const { return _pieces; }
+	const Piece* end() const { return _pieces + _size; }
+
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+
+	Piece& operator[](size_t idx) { return _pieces[idx]; }
+	const Piece& operator[](size_t idx) const { return _pieces[idx]; }
+
+	// false (leaving the list unchanged) when it's already full
+	bool push_back(const Piece& piece);
+
+	// shifts the rest down, so the remaining pieces keep their order
+	void erase(Piece* piece);
+
+	void clear() { _size = 0; }
+
+private:
+	Piece _pieces[MAX_PIECES];
+	uint8_t _size;
+};
+
+// more than any position has pseudo-legal moves (the most known is 218 legal)
+const uint MAX_MOVES = 256;
+
+// fixed capacity move buffer, so generating moves doesn't touch the heap
+class MoveList {
+public:
+	MoveList() : _size(0) {}
+
+	Move* begin() { return _moves; }
+	Move* end() { return _moves + _size; }
+	const Move* begin() const { return _moves; }
+	const Move* end() const { return _moves + _size; }
+
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+
+	Move& operator[](size_t idx) { return _moves[idx]; }
+	const Move& operator[](size_t idx) const { return _moves[idx]; }
+
+	void push_back(const Move& move) { _moves[_size++] = move; }
+
+	void clear() { _size = 0; }
+
+private:
+	Move _moves[MAX_MOVES];
+	uint _size;
+};
+
+// positions remembered for repetition detection; the fifty move rule caps the useful window at 100 plies anyway
+const uint KEY_HISTORY_SIZE = 128;
+
 class Game {
 public:
 	Game();
-	Game(const Game& other);
+	// every member is fixed size, so copying (and with it branch) is a single memcpy
+	Game(const Game& other) = default;
 	Game(const std::string& fen);
 
 	// returns true if pawn reached promotion (also sets shouldPromote private variable)
@@ -69,25 +146,60 @@ public:
 	bool isChecked() const;
 	bool isChecked(Players player) const;
 
+	// checkmate/stalemate need a legal move search, every draw rule is answered from counters kept up to date by move
+	GameStates status() const;
+
 	std::string dumpFEN() const;
 
 	Piece getPiece(const Position& pos) const;
 
 	bool hasPiece(const Position& pos) const;
 
+	const PieceList& pieces(Players player) const;
+
 	Players turn() const;
 
 	bool shouldPromote() const;
 
+	// king and the rook on that side are both unmoved (doesn't check whether castling is currently legal)
+	bool canCastle(Players player, bool kingSide) const;
+
+	// true if the last move was a double pawn push, in which case target is the square it skipped over
+	bool enPassantTarget(Position& target) const;
+
 	int turns() const { return _turns; }
 
 	int halfTurnsSinceCapture() const { return _halfTurnsSinceCapture; }
 
-	Game& operator=(const Game& other);
+	// incrementally maintained piece-square sums (see eval.h)
+	int mgScore(Players player) const { return _mgScore[player]; }
+	int egScore(Players player) const { return _egScore[player]; }
+	int phase() const { return _phase; }
+
+	// zobrist key of the pawn placement alone (see pawns.h)
+	uint64_t pawnKey() const { return _pawnKey; }
+
+	// zobrist key of the whole position (pieces, side to move, castling rights, capturable en passant square)
+	uint64_t key() const { return _key; }
+
+	// how many times the current position occurred before, since the last capture or pawn move
+	uint repetitions() const { return _repetitions; }
+
+	// attack maps, kept up to date by move and promote: the squares player attacks (see geometry.h) and by how many pieces
+	uint64_t attacked(Players player) const { return _attacked[player]; }
+	uint attackers(Players player, const Position& pos) const { return _attackers[player][squareOf(pos)]; }
+
+	Game& operator=(const Game& other) = default;
+
+	friend FENError parseFEN(std::string_view fen, Game& game);
+	friend void unpackPosition(const PackedPosition& packed, Game& game);
+	// generates from the candidate moves directly rather than validating everything twice
+	friend class Searcher;
+	friend class MCTS;
 
 private:
-	std::vector<Piece> _white;
-	std::vector<Piece> _black;
+	PieceList _white;
+	PieceList _black;
 	Players _turn;
 	bool _firstMove;
 	Move _prevMove;
@@ -95,16 +207,64 @@ private:
 	bool _shouldPromote;
 	int _turns;
 	int _halfTurnsSinceCapture;
+	int _mgScore[2];
+	int _egScore[2];
+	int _phase;
+	uint64_t _pawnKey;
+	uint64_t _pieceKey;
+	uint64_t _key;
+	uint64_t _keyHistory[KEY_HISTORY_SIZE];	 // ring buffer, _historyEnd is the next slot to write
+	uint _historyEnd;
+	uint _historySize;
+	uint _repetitions;
+	uint8_t _attackers[2][64];	// [player][square] how many of player's pieces attack the square
+	uint64_t _attacked[2];		// squares with at least one attacker
 
 	Piece& _getPieceRef(const Position& pos);
 
-	Game _uncheckedBranch(const Move& move) const;
+	// bit per occupied square (see geometry.h), from the piece lists
+	uint64_t _occupancy() const;
+
+	// keep the incremental evaluation sums and keys in sync with piece placement (the reset rebuilds the attack maps as well)
+	void _addPieceState(const Piece& piece);
+	void _removePieceState(const Piece& piece);
+	void _resetPieceState();
+
+	// adds (delta 1) or takes back (delta -1) the squares piece attacks, given the occupancy they were worked out on
+	void _toggleAttacks(const Piece& piece, uint64_t occupied, int delta);
+	void _resetAttacks();
+	// runs place, which changes what stands on the changed squares, and redoes the attacks of the pieces on them and of the
+	// sliders that reach them; nothing else moved, so nothing else's attacks changed
+	template <typename Place> void _updateAttacks(uint64_t changed, const Place& place);
+
+	// finishes the position key once the turn has passed and pushes it onto the history
+	void _recordPosition();
+	void _resetHistory();
 
-	void _validatePawnMove(const Move& move) const;
+	bool _insufficientMaterial() const;
+
+	// moves that follow piece movement rules but may leave the king in check
+	void _candidateMoves(MoveList& out) const;
+
+	// instantiated for each side, so pawn directions and the start, back and promotion ranks are compile time constants;
+	// move, isChecked and the untemplated _candidateMoves only pick the instantiation for the side
+	template <Players Us> bool _move(const Move& move);
+	template <Players Us> void _candidateMoves(MoveList& out) const;
+	template <Players Us> bool _isChecked() const;
+	// whether Us's king on king would be attacked after move, captured being the square of whatever it takes (to unless it's
+	// en passant)
+	template <Players Us> bool _leavesInCheck(const Move& move, uint king, uint captured) const;
+
+	template <Players P> PieceList& _piecesOf() { return P == Players::WHITE ? _white : _black; }
+	template <Players P> const PieceList& _piecesOf() const { return P == Players::WHITE ? _white : _black; }
+
+	template <Players Us> void _validatePawnMove(const Move& move) const;
 	void _validateKnightMove(const Move& move) const;
 	void _validateBishopMove(const Move& move) const;
 	void _validateRookMove(const Move& move) const;
 	void _validateKingMove(const Move& move) const;
 };
 
+static_assert(std::is_trivially_copyable_v<Game>, "Game must stay trivially copyable");
+
 #endif
\ No newline at end of file
@@ -4,6 +4,32 @@ const Files FILES[8] = {A, B, C, D, E, F, G, H};
 const uint RANKS[8] = {1, 2, 3, 4, 5, 6, 7, 8};
 const PieceTypes PIECE_TYPES[6] = {PieceTypes::PAWN, PieceTypes::KNIGHT, PieceTypes::BISHOP, PieceTypes::ROOK, PieceTypes::QUEEN, PieceTypes::KING};
 
+static constexpr ZobristKeys generateZobristKeys() {
+	ZobristKeys keys = {};
+	uint64_t state = 0x5400;
+
+	for (auto& player : keys.pieces) {
+		for (auto& type : player) {
+			for (uint64_t& key : type) {
+				key = splitMix64(state);
+			}
+		}
+	}
+	for (auto& player : keys.castling) {
+		for (uint64_t& key : player) {
+			key = splitMix64(state);
+		}
+	}
+	for (uint64_t& key : keys.enPassant) {
+		key = splitMix64(state);
+	}
+	keys.turn = splitMix64(state);
+
+	return keys;
+}
+
+constinit const ZobristKeys ZOBRIST = generateZobristKeys();
+
 uint valueOf(PieceTypes type) {
 	switch (type) {
 		case PieceTypes::PAWN:
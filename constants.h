@@ -1,11 +1,14 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstdint>
+
 #include "types.h"
 
 enum Players { WHITE, BLACK };
 enum Files { A, B, C, D, E, F, G, H };
 enum PieceTypes { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+enum GameStates { IN_PROGRESS, CHECKMATE, STALEMATE, REPETITION, FIFTY_MOVES, INSUFFICIENT_MATERIAL };
 
 extern const Files FILES[8];
 extern const uint RANKS[8];
@@ -13,4 +16,23 @@ extern const PieceTypes PIECE_TYPES[6];
 
 uint valueOf(PieceTypes type);
 
+// deterministic 64 bit generator for building key tables at compile time
+constexpr uint64_t splitMix64(uint64_t& state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+	return z ^ (z >> 31);
+}
+
+// random keys for zobrist hashing, generated at compile time from a fixed seed so keys are stable across builds
+struct ZobristKeys {
+	uint64_t pieces[2][6][64];	// [player][piece type][square]
+	uint64_t castling[2][2];	// [player][king side]
+	uint64_t enPassant[8];		// [file]
+	uint64_t turn;				// black to move
+};
+
+extern const ZobristKeys ZOBRIST;
+
 #endif
\ No newline at end of file
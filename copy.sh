@@ -2,5 +2,5 @@
 
 DIR=$(pwd)
 cd /home/jason/cs/cs5400/chess-engine
-cp board.cpp chess.cpp constants.cpp *.h $DIR/$1
+cp board.cpp chess.cpp constants.cpp fen.cpp eval.cpp nnue.cpp pawns.cpp mapped_file.cpp polyglot.cpp bitbase.cpp packed.cpp batch.cpp pgn.cpp arena.cpp search.cpp mcts.cpp sprt.cpp *.h $DIR/$1
 cd $DIR
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "chess.h"
+#include "nnue.h"
+#include "packed.h"
+#include "queue.h"
+#include "search.h"
+
+using namespace std;
+
+struct DatagenConfig {
+	uint threads = max(1u, thread::hardware_concurrency());
+	SearchLimits limits = {.depth = 0, .nodes = 5000, .milliseconds = 0};
+	uint randomPlies = 8;  // uniformly random moves from the starting position before the engines take over
+	uint maxPlies = 400;   // then it's a draw
+	uint64_t shardBytes = 0;  // start a new file once this many bytes are written, 0 for one file
+	uint64_t seed = 0;
+	string network;
+};
+
+static void parseOption(const string& option, DatagenConfig& config) {
+	size_t eq = option.find('=');
+	if (eq == string::npos) {
+		throw runtime_error("Expected key=value, got '" + option + "'.");
+	}
+
+	string key = option.substr(0, eq), value = option.substr(eq + 1);
+
+	if (key == "threads") {
+		config.threads = max(1ul, stoul(value));
+	} else if (key == "depth") {
+		config.limits.depth = stoul(value);
+		config.limits.nodes = 0;
+	} else if (key == "nodes") {
+		config.limits.nodes = stoull(value);
+	} else if (key == "randomplies") {
+		config.randomPlies = stoul(value);
+	} else if (key == "maxplies") {
+		config.maxPlies = stoul(value);
+	} else if (key == "shard") {
+		config.shardBytes = stoull(value) << 20;
+	} else if (key == "seed") {
+		config.seed = stoull(value);
+	} else if (key == "nnue") {
+		config.network = value;
+	} else {
+		throw runtime_error("Bad option '" + option + "'.");
+	}
+}
+
+// data.bin -> data-3.bin
+static string shardPath(const string& path, uint shard) {
+	filesystem::path p(path);
+
+	return (p.parent_path() / (p.stem().string() + "-" + to_string(shard) + p.extension().string())).string();
+}
+
+// plays random legal moves from the starting position; false if that ran into the end of the game
+static bool randomOpening(Game& game, uint plies, mt19937_64& rng) {
+	game = Game();
+
+	for (uint ply = 0; ply < plies; ply++) {
+		vector<Move> moves = game.getAvailableMoves();
+		if (moves.empty()) {
+			return false;
+		}
+
+		Move move = moves[rng() % moves.size()];
+		if (game.move(move)) {
+			game.promote(move.to, PieceTypes::QUEEN);
+		}
+	}
+
+	return game.status() == GameStates::IN_PROGRESS;
+}
+
+/*
+ * Plays one self-play game and labels every position the search was asked about with its score, then the game's result once
+ * it's known. Positions in check and positions whose best move captures or promotes are left out: their static evaluation is
+ * about to change by a lot, so they only add noise when tuning an evaluation against search scores.
+ */
+static void playGame(Searcher& searcher, const DatagenConfig& config, mt19937_64& rng, vector<PackedPosition>& records) {
+	Game game;
+	while (!randomOpening(game, config.randomPlies, rng)) {
+	}
+
+	searcher.clear();
+	records.clear();
+
+	uint8_t result = 1;
+	for (uint ply = 0; ply < config.maxPlies; ply++) {
+		GameStates state = game.status();
+		if (state == GameStates::CHECKMATE) {
+			result = game.turn() == Players::WHITE ? 0 : 2;
+		}
+		if (state != GameStates::IN_PROGRESS) {
+			break;
+		}
+
+		SearchResult found = searcher.search(game, config.limits);
+
+		// a found mate is as good as played out
+		if (abs(found.score) > MATE_BOUND) {
+			result = (found.score > 0) == (game.turn() == Players::WHITE) ? 2 : 0;
+			break;
+		}
+
+		bool capture = game.hasPiece(found.move.to) ||
+					   (game.getPiece(found.move.from).type() == PieceTypes::PAWN && found.move.to.file != found.move.from.file);
+		if (!game.isChecked() && !capture && found.promotion == PieceTypes::PAWN) {
+			PackedPosition packed = packPosition(game);
+			packed.score = found.score;
+			records.push_back(packed);
+		}
+
+		if (game.move(found.move)) {
+			game.promote(found.move.to, found.promotion);
+		}
+	}
+
+	for (PackedPosition& packed : records) {
+		packed.result = result;
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		cout << "Usage: " << argv[0] << " <output.bin> <games> [option=value ...]" << endl;
+		cout << "  options: threads=N, nodes=N (default 5000), depth=N, randomplies=N (default 8), maxplies=N (default 400)," << endl;
+		cout << "           shard=MB (rotate to output-0.bin, output-1.bin, ...), seed=N, nnue=weights file" << endl;
+		return 1;
+	}
+
+	string output = argv[1];
+	uint64_t games = stoull(argv[2]);
+	DatagenConfig config;
+	unique_ptr<Network> network;
+
+	try {
+		for (int i = 3; i < argc; i++) {
+			parseOption(argv[i], config);
+		}
+		if (!config.network.empty()) {
+			network = make_unique<Network>(config.network);
+		}
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+
+	// workers only ever wait on the writer when it falls a whole queue behind
+	BoundedQueue<PackedPosition> queue(1 << 16);
+	atomic<uint64_t> nextGame = 0, gamesDone = 0;
+	atomic<uint> workersDone = 0;
+	atomic<bool> failed = false;  // the writer gave up, stop producing
+
+	vector<thread> workers;
+	for (uint t = 0; t < config.threads; t++) {
+		workers.emplace_back([&, t]() {
+			Searcher searcher(1 << 16, network.get());
+			mt19937_64 rng(config.seed * 0x9E3779B97F4A7C15ull + t);
+			vector<PackedPosition> records;
+
+			while (!failed && nextGame++ < games) {
+				playGame(searcher, config, rng, records);
+
+				for (const PackedPosition& packed : records) {
+					while (!queue.tryPush(packed) && !failed) {
+						this_thread::yield();
+					}
+				}
+				gamesDone++;
+			}
+
+			workersDone++;
+		});
+	}
+
+	// the only thread touching the files
+	uint shard = 0;
+	uint64_t total = 0;
+	auto start = chrono::steady_clock::now();
+	unique_ptr<PackedPositionWriter> writer;
+
+	try {
+		writer = make_unique<PackedPositionWriter>(config.shardBytes ? shardPath(output, shard) : output);
+
+		PackedPosition packed;
+		for (;;) {
+			if (!queue.tryPop(packed)) {
+				// checked before the last pop attempt, so nothing pushed before the workers finished gets lost
+				if (workersDone == config.threads && !queue.tryPop(packed)) {
+					break;
+				} else if (workersDone < config.threads) {
+					this_thread::sleep_for(chrono::milliseconds(1));
+					continue;
+				}
+			}
+
+			if (config.shardBytes && writer->written() * sizeof(PackedPosition) >= config.shardBytes) {
+				writer->flush();
+				writer = make_unique<PackedPositionWriter>(shardPath(output, ++shard));
+			}
+
+			writer->write(packed);
+
+			if (++total % 100000 == 0) {
+				double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				cout << total << " positions from " << gamesDone << " games, " << (uint64_t)(total / seconds) << " positions/s" << endl;
+			}
+		}
+
+		writer->flush();
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		failed = true;
+	}
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+	if (failed) {
+		return 1;
+	}
+
+	cout << total << " positions from " << gamesDone << " games written to " << (shard + 1) << " file" << (shard ? "s" : "") << endl;
+
+	return 0;
+}
\ No newline at end of file
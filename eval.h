@@ -0,0 +1,22 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "chess.h"
+#include "pawns.h"
+
+// phase weight of a full set of non-pawn material (4 minors, 4 rooks, 2 queens)
+extern const int MAX_PHASE;
+
+// piece value + piece-square bonus, from the perspective of the piece's owner
+int mgValue(PieceTypes type, Players player, const Position& pos);
+int egValue(PieceTypes type, Players player, const Position& pos);
+
+// how much a piece of this type contributes to the game phase (0 for pawns and kings)
+int phaseOf(PieceTypes type);
+
+// tapered evaluation in centipawns, relative to the side to move; only reads the sums kept by Game, so it's a handful of additions
+int evaluate(const Game& game);
+// same, plus pawn structure and king shelter terms looked up in (or added to) the pawn table
+int evaluate(const Game& game, PawnTable& pawns);
+
+#endif
\ No newline at end of file
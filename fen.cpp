@@ -0,0 +1,332 @@
+#include "fen.h"
+
+#include <charconv>
+
+using namespace std;
+
+string to_string(const FENError& error) {
+	string message;
+
+	switch (error.code) {
+		case FENErrors::VALID_FEN:
+			return "valid FEN";
+		case FENErrors::BAD_PLACEMENT:
+			message = "bad piece placement";
+			break;
+		case FENErrors::BAD_KINGS:
+			message = "each side needs exactly one king";
+			break;
+		case FENErrors::BAD_SIDE_TO_MOVE:
+			message = "side to move must be 'w' or 'b'";
+			break;
+		case FENErrors::BAD_CASTLING:
+			message = "bad castling rights";
+			break;
+		case FENErrors::BAD_EN_PASSANT:
+			message = "bad en passant square";
+			break;
+		case FENErrors::BAD_CLOCK:
+			message = "bad move clock";
+			break;
+		case FENErrors::MISSING_FIELD:
+			message = "missing field";
+			break;
+		case FENErrors::TRAILING_CHARACTERS:
+			message = "unexpected characters after the last field";
+			break;
+	}
+
+	return message + " at character " + std::to_string(error.offset);
+}
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// moves i past any whitespace, false if that runs off the end
+static bool skipSpaces(string_view fen, size_t& i) {
+	while (i < fen.size() && isSpace(fen[i])) {
+		i++;
+	}
+
+	return i < fen.size();
+}
+
+static bool isPieceSymbol(char c) {
+	switch (c) {
+		case 'p':
+		case 'n':
+		case 'b':
+		case 'r':
+		case 'q':
+		case 'k':
+		case 'P':
+		case 'N':
+		case 'B':
+		case 'R':
+		case 'Q':
+		case 'K':
+			return true;
+		default:
+			return false;
+	}
+}
+
+static FENError parseClock(string_view fen, size_t& i, int& out) {
+	size_t end = i;
+	while (end < fen.size() && !isSpace(fen[end])) {
+		end++;
+	}
+
+	auto [ptr, ec] = from_chars(fen.data() + i, fen.data() + end, out);
+	if (ec != errc() || ptr != fen.data() + end || out < 0) {
+		return {FENErrors::BAD_CLOCK, i};
+	}
+
+	i = end;
+	return {FENErrors::VALID_FEN, i};
+}
+
+FENError parseFEN(string_view fen, Game& game) {
+	size_t i = 0;
+
+	game._white.clear();
+	game._black.clear();
+
+	if (!skipSpaces(fen, i)) {
+		return {FENErrors::MISSING_FIELD, i};
+	}
+
+	// piece placement, rank 8 first; the file runs to 8 (past H) at the end of every rank, so it's kept as a plain int
+	int file = 0;
+	uint rank = 8;
+	uint kings[2] = {0, 0};
+	for (; i < fen.size() && !isSpace(fen[i]); i++) {
+		char c = fen[i];
+
+		if (c == '/') {
+			if (file != 8 || rank == 1) {
+				return {FENErrors::BAD_PLACEMENT, i};
+			}
+
+			file = 0;
+			rank--;
+		} else if (c >= '1' && c <= '8') {
+			if (file + (c - '0') > 8) {
+				return {FENErrors::BAD_PLACEMENT, i};
+			}
+
+			file += c - '0';
+		} else if (isPieceSymbol(c) && file < 8) {
+			Piece piece(c, {.file = (Files)file, .rank = rank});
+
+			if (piece._type == PieceTypes::PAWN && (rank == 1 || rank == 8)) {
+				return {FENErrors::BAD_PLACEMENT, i};
+			}
+			if (piece._type == PieceTypes::KING) {
+				kings[piece._player]++;
+			}
+			if (piece._type == PieceTypes::ROOK) {
+				piece._moved = true;  // until the castling field says otherwise
+			}
+
+			if (!(piece._player == Players::WHITE ? game._white : game._black).push_back(piece)) {
+				return {FENErrors::BAD_PLACEMENT, i};  // more than MAX_PIECES on one side
+			}
+			file++;
+		} else {
+			return {FENErrors::BAD_PLACEMENT, i};
+		}
+	}
+
+	if (file != 8 || rank != 1) {
+		return {FENErrors::BAD_PLACEMENT, i};
+	}
+	if (kings[Players::WHITE] != 1 || kings[Players::BLACK] != 1) {
+		return {FENErrors::BAD_KINGS, 0};
+	}
+
+	// side to move
+	if (!skipSpaces(fen, i)) {
+		return {FENErrors::MISSING_FIELD, i};
+	}
+	if ((fen[i] != 'w' && fen[i] != 'b') || (i + 1 < fen.size() && !isSpace(fen[i + 1]))) {
+		return {FENErrors::BAD_SIDE_TO_MOVE, i};
+	}
+	game._turn = fen[i] == 'w' ? Players::WHITE : Players::BLACK;
+	i++;
+
+	// castling rights, marking the matching rooks unmoved
+	if (!skipSpaces(fen, i)) {
+		return {FENErrors::MISSING_FIELD, i};
+	}
+	if (fen[i] == '-') {
+		i++;
+	} else {
+		for (; i < fen.size() && !isSpace(fen[i]); i++) {
+			char c = fen[i];
+			bool white = c == 'K' || c == 'Q';
+			Position rookPos = {.file = c == 'K' || c == 'k' ? Files::H : Files::A, .rank = white ? 1u : 8u};
+			bool found = false;
+
+			if (c != 'K' && c != 'Q' && c != 'k' && c != 'q') {
+				return {FENErrors::BAD_CASTLING, i};
+			}
+
+			for (Piece& piece : white ? game._white : game._black) {
+				if (piece._type == PieceTypes::ROOK && piece._position == rookPos) {
+					piece._moved = false;
+					found = true;
+				}
+			}
+
+			if (!found) {
+				return {FENErrors::BAD_CASTLING, i};
+			}
+		}
+	}
+	if (i < fen.size() && !isSpace(fen[i])) {
+		return {FENErrors::BAD_CASTLING, i};
+	}
+
+	// en passant square, stored the way Game remembers it: as the double push that was just played
+	if (!skipSpaces(fen, i)) {
+		return {FENErrors::MISSING_FIELD, i};
+	}
+	game._firstMove = true;
+	game._prevMoveEnPassant = false;
+	game._shouldPromote = false;
+	if (fen[i] == '-') {
+		i++;
+	} else {
+		uint epRank = game._turn == Players::WHITE ? 6 : 3;
+
+		if (i + 1 >= fen.size() || fen[i] < 'a' || fen[i] > 'h' || (uint)(fen[i + 1] - '0') != epRank) {
+			return {FENErrors::BAD_EN_PASSANT, i};
+		}
+
+		Files file = (Files)(fen[i] - 'a');
+		Position pushedTo = {.file = file, .rank = game._turn == Players::WHITE ? 5u : 4u};
+		bool found = false;
+
+		for (const Piece& piece : game._turn == Players::WHITE ? game._black : game._white) {
+			if (piece._type == PieceTypes::PAWN && piece._position == pushedTo) {
+				found = true;
+			}
+		}
+		if (!found) {
+			return {FENErrors::BAD_EN_PASSANT, i};
+		}
+
+		game._firstMove = false;
+		game._prevMove = {.from = {.file = file, .rank = game._turn == Players::WHITE ? 7u : 2u}, .to = pushedTo};
+		i += 2;
+	}
+	if (i < fen.size() && !isSpace(fen[i])) {
+		return {FENErrors::BAD_EN_PASSANT, i};
+	}
+
+	// clocks are optional (EPD), and anything that doesn't start with a digit is taken as EPD operations
+	game._halfTurnsSinceCapture = 0;
+	game._turns = 1;
+	if (skipSpaces(fen, i) && fen[i] >= '0' && fen[i] <= '9') {
+		FENError error = parseClock(fen, i, game._halfTurnsSinceCapture);
+		if (error) {
+			return error;
+		}
+
+		if (!skipSpaces(fen, i)) {
+			return {FENErrors::MISSING_FIELD, i};
+		}
+		if ((error = parseClock(fen, i, game._turns))) {
+			return error;
+		}
+
+		if (skipSpaces(fen, i)) {
+			return {FENErrors::TRAILING_CHARACTERS, i};
+		}
+	}
+
+	game._resetPieceState();
+	game._resetHistory();
+
+	return {FENErrors::VALID_FEN, i};
+}
+
+char* writeEPD(const Game& game, char* out) {
+	// one pass over the pieces instead of looking up all 64 squares
+	char board[64] = {};
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		for (const Piece& piece : game.pieces(player)) {
+			board[squareOf(piece.position())] = piece.symbol();
+		}
+	}
+
+	for (int rank = 7; rank >= 0; rank--) {
+		char empty = '0';
+
+		for (int file = 0; file < 8; file++) {
+			char symbol = board[rank * 8 + file];
+
+			if (symbol == 0) {
+				empty++;
+			} else {
+				if (empty != '0') {
+					*out++ = empty;
+					empty = '0';
+				}
+				*out++ = symbol;
+			}
+		}
+
+		if (empty != '0') {
+			*out++ = empty;
+		}
+		if (rank != 0) {
+			*out++ = '/';
+		}
+	}
+
+	*out++ = ' ';
+	*out++ = game.turn() == Players::WHITE ? 'w' : 'b';
+
+	*out++ = ' ';
+	char* castling = out;
+	if (game.canCastle(Players::WHITE, true)) {
+		*out++ = 'K';
+	}
+	if (game.canCastle(Players::WHITE, false)) {
+		*out++ = 'Q';
+	}
+	if (game.canCastle(Players::BLACK, true)) {
+		*out++ = 'k';
+	}
+	if (game.canCastle(Players::BLACK, false)) {
+		*out++ = 'q';
+	}
+	if (out == castling) {
+		*out++ = '-';
+	}
+
+	*out++ = ' ';
+	Position target;
+	if (game.enPassantTarget(target)) {
+		*out++ = 'a' + target.file;
+		*out++ = '0' + target.rank;
+	} else {
+		*out++ = '-';
+	}
+
+	return out;
+}
+
+char* writeFEN(const Game& game, char* out) {
+	out = writeEPD(game, out);
+
+	*out++ = ' ';
+	out = to_chars(out, out + 10, game.halfTurnsSinceCapture()).ptr;
+	*out++ = ' ';
+	out = to_chars(out, out + 10, game.turns()).ptr;
+
+	return out;
+}
\ No newline at end of file
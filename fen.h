@@ -0,0 +1,36 @@
+#ifndef FEN_H
+#define FEN_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "chess.h"
+
+enum FENErrors { VALID_FEN, BAD_PLACEMENT, BAD_KINGS, BAD_SIDE_TO_MOVE, BAD_CASTLING, BAD_EN_PASSANT, BAD_CLOCK, MISSING_FIELD, TRAILING_CHARACTERS };
+
+struct FENError {
+	FENErrors code;
+	size_t offset;	// index into the input where parsing stopped
+
+	explicit operator bool() const { return code != FENErrors::VALID_FEN; }
+};
+
+std::string to_string(const FENError& error);
+
+/*
+ * Parses 6 field FEN or 4 field EPD (clocks default to 0 and 1, any EPD operations after the 4th field are skipped) into game,
+ * reusing its piece storage so parsing many positions into one Game doesn't allocate. Never throws or reads past the end of fen;
+ * on error game is left in an unspecified (but destructible) state.
+ */
+FENError parseFEN(std::string_view fen, Game& game);
+
+// longest output of writeFEN: 64 pieces and 7 slashes, side, "KQkq", an en passant square and two 10 digit clocks, plus separators
+const size_t MAX_FEN_LENGTH = 103;
+
+// writes FEN (or just the 4 EPD fields) starting at out, which needs MAX_FEN_LENGTH chars of room; like std::to_chars, returns one past
+// the last character written and doesn't null terminate. The en passant square is written after every double push.
+char* writeFEN(const Game& game, char* out);
+char* writeEPD(const Game& game, char* out);
+
+#endif
\ No newline at end of file
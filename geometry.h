@@ -0,0 +1,112 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <bit>
+#include <cstdint>
+
+#include "types.h"
+
+/*
+ * Board geometry by square index (squareOf, 0 is A1), generated at compile time. Being constexpr there's nothing to initialize
+ * at startup and no order to get wrong between translation units, and it's header only so nothing gets added to the build
+ * scripts. Slider questions turn into a mask and a test: a rook on a sees b iff b is on a's orthogonal rays and nothing occupies
+ * between[a][b].
+ */
+
+enum Directions { NORTH, NORTH_EAST, EAST, SOUTH_EAST, SOUTH, SOUTH_WEST, WEST, NORTH_WEST, DIRECTIONS };
+
+constexpr int DIRECTION_FILES[DIRECTIONS] = {0, 1, 1, 1, 0, -1, -1, -1};
+constexpr int DIRECTION_RANKS[DIRECTIONS] = {1, 1, 0, -1, -1, -1, 0, 1};
+
+constexpr uint64_t squareBit(uint square) {
+	return 1ull << square;
+}
+
+struct Geometry {
+	uint64_t rays[64][DIRECTIONS];	// from the square (not included) to the edge of the board
+	uint64_t orthogonal[64];		// every square a rook sees on an empty board
+	uint64_t diagonal[64];			// the same for a bishop
+	uint64_t between[64][64];		// strictly between two squares on a common rank, file or diagonal, 0 otherwise
+	uint64_t line[64][64];			// the whole line through two such squares, edge to edge, 0 otherwise
+	uint64_t knight[64];			// attacks of a knight, king or pawn ([Players]) on the square
+	uint64_t king[64];
+	uint64_t pawn[2][64];
+	uint8_t chebyshev[64][64];		// king steps
+	uint8_t manhattan[64][64];		// rank plus file difference
+};
+
+constexpr Geometry generateGeometry() {
+	Geometry geometry = {};
+
+	for (int square = 0; square < 64; square++) {
+		int file = square % 8, rank = square / 8;
+
+		for (int dir = 0; dir < DIRECTIONS; dir++) {
+			uint64_t path = 0;
+
+			for (int f = file + DIRECTION_FILES[dir], r = rank + DIRECTION_RANKS[dir]; f >= 0 && f < 8 && r >= 0 && r < 8;
+				 f += DIRECTION_FILES[dir], r += DIRECTION_RANKS[dir]) {
+				geometry.between[square][r * 8 + f] = path;
+				path |= squareBit(r * 8 + f);
+			}
+
+			geometry.rays[square][dir] = path;
+			(dir % 2 ? geometry.diagonal : geometry.orthogonal)[square] |= path;
+		}
+
+		for (int other = 0; other < 64; other++) {
+			int fileDiff = other % 8 - file, rankDiff = other / 8 - rank;
+			int forward = rankDiff;
+			fileDiff = fileDiff < 0 ? -fileDiff : fileDiff;
+			rankDiff = rankDiff < 0 ? -rankDiff : rankDiff;
+
+			geometry.chebyshev[square][other] = fileDiff > rankDiff ? fileDiff : rankDiff;
+			geometry.manhattan[square][other] = fileDiff + rankDiff;
+
+			if (geometry.chebyshev[square][other] == 2 && geometry.manhattan[square][other] == 3) {
+				geometry.knight[square] |= squareBit(other);
+			}
+			if (geometry.chebyshev[square][other] == 1) {
+				geometry.king[square] |= squareBit(other);
+			}
+			if (fileDiff == 1 && (forward == 1 || forward == -1)) {
+				geometry.pawn[forward == 1 ? 0 : 1][square] |= squareBit(other);
+			}
+		}
+	}
+
+	// needs every ray first, the line through two squares is the pair of opposite rays through either of them
+	for (int square = 0; square < 64; square++) {
+		for (int dir = 0; dir < DIRECTIONS; dir++) {
+			uint64_t line = geometry.rays[square][dir] | geometry.rays[square][(dir + 4) % DIRECTIONS] | squareBit(square);
+
+			for (uint64_t ray = geometry.rays[square][dir]; ray; ray &= ray - 1) {
+				geometry.line[square][std::countr_zero(ray)] = line;
+			}
+		}
+	}
+
+	return geometry;
+}
+
+inline constexpr Geometry GEOMETRY = generateGeometry();
+
+// squares a bishop (diagonal) or rook sees from square, up to and including the first occupied one in each direction
+constexpr uint64_t slidingAttacks(uint square, uint64_t occupied, bool diagonal) {
+	uint64_t attacks = 0;
+
+	for (int dir = diagonal ? 1 : 0; dir < DIRECTIONS; dir += 2) {
+		uint64_t ray = GEOMETRY.rays[square][dir], blockers = ray & occupied;
+
+		if (blockers) {
+			// rays going up the board meet their lowest blocker first
+			uint first = DIRECTION_RANKS[dir] * 8 + DIRECTION_FILES[dir] > 0 ? std::countr_zero(blockers) : 63 - std::countl_zero(blockers);
+			ray ^= GEOMETRY.rays[first][dir];
+		}
+		attacks |= ray;
+	}
+
+	return attacks;
+}
+
+#endif
\ No newline at end of file
@@ -1,12 +1,82 @@
 #include <curses.h>
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include "chess.h"
+#include "pgn.h"
+#include "search.h"
 
 using namespace std;
 
-void printBoard(const Game& game, bool squareSelected, const Position& selectedSquare);
+/*
+ * Searches the position on the board on a background thread and keeps a description of the last finished depth for the screen
+ * to pick up, so input never waits on the engine. Only the main thread touches ncurses.
+ */
+class Analysis {
+public:
+	Analysis() : _searcher(1 << 18), _stop(false), _version(0) {}
+	~Analysis() { stop(); }
+
+	// drops whatever was being analyzed and starts on game (unless it's over or waiting on a promotion)
+	void start(const Game& game);
+	void stop();
+
+	// bumped on every change to the description
+	uint64_t version();
+	void describe(string& info, string& pv);
+
+private:
+	Searcher _searcher;
+	thread _thread;
+	atomic<bool> _stop;
+	mutex _mutex;  // guards everything below
+	uint64_t _version;
+	string _info;
+	string _pv;
+
+	void _publish(const string& info, const string& pv);
+};
+
+/*
+ * The board part of the screen. Remembers what every square was last drawn as and only redraws the ones whose piece or
+ * highlight changed, and works out check and the selected piece's legal targets once per position instead of once per square.
+ */
+class BoardView {
+public:
+	BoardView() : _drawn(false), _cachedKey(0), _cachedTurn(Players::WHITE), _cachedPromotion(false), _checked(false), _movesValid(false) {}
+
+	void draw(const Game& game, bool squareSelected, const Position& selectedSquare);
+
+	// the screen was wiped (say by a resize), so the next draw paints every square
+	void invalidate() { _drawn = false; }
+
+	// of the position last drawn
+	bool checked() const { return _checked; }
+
+private:
+	struct Square {
+		char symbol;  // ' ' when empty
+		int attributes;
+	};
+
+	Square _squares[64];  // as on screen, by squareOf
+	bool _drawn;
+
+	// worked out once per position, the legal moves only once something is selected; the key stays put while a promotion is
+	// pending, so the turn and the pending promotion are part of what identifies the position
+	uint64_t _cachedKey;
+	Players _cachedTurn;
+	bool _cachedPromotion;
+	bool _checked;
+	bool _movesValid;
+	vector<Move> _moves;
+};
+
+// redraws the analysis lines if they changed since shown (or always with force)
+void printAnalysis(Analysis& analysis, uint64_t& shown, bool force);
 
 int main(int argc, char** argv) {
 	int ch = '\0';
@@ -23,6 +93,7 @@ int main(int argc, char** argv) {
 	noecho();
 	cbreak();
 	keypad(stdscr, true);
+	timeout(100);  // getch returns ERR this often without input, which is when analysis updates get drawn
 	mousemask(BUTTON1_CLICKED | BUTTON2_CLICKED | BUTTON3_CLICKED, nullptr);
 	init_pair(1, COLOR_WHITE, COLOR_GREEN);
 	init_pair(2, COLOR_BLACK, COLOR_RED);
@@ -40,6 +111,11 @@ int main(int argc, char** argv) {
 		Position selectedSquare, promotionSquare;
 		string error;
 
+		BoardView board;
+		Analysis analysis;
+		uint64_t shownAnalysis = 0;
+		bool changed = true;  // the position changed, restart the analysis
+
 		do {
 			switch (ch) {
 				case KEY_MOUSE:
@@ -56,6 +132,7 @@ int main(int argc, char** argv) {
 												promotionSquare = pos;
 											}
 											squareSelected = false;
+											changed = true;
 											error = "";
 										} catch (const runtime_error& e) {
 											error = e.what();
@@ -73,15 +150,19 @@ int main(int argc, char** argv) {
 								if (event.y == 1 && event.x >= 32 && event.y < 37) {
 									game.promote(promotionSquare, PieceTypes::QUEEN);
 									promoting = false;
+									changed = true;
 								} else if (event.y == 2 && event.x >= 32 && event.y < 36) {
 									game.promote(promotionSquare, PieceTypes::ROOK);
 									promoting = false;
+									changed = true;
 								} else if (event.y == 3 && event.x >= 32 && event.y < 38) {
 									game.promote(promotionSquare, PieceTypes::BISHOP);
 									promoting = false;
+									changed = true;
 								} else if (event.y == 4 && event.x >= 32 && event.y < 38) {
 									game.promote(promotionSquare, PieceTypes::KNIGHT);
 									promoting = false;
+									changed = true;
 								}
 							}
 						} else if (event.bstate & BUTTON2_CLICKED || event.bstate & BUTTON3_CLICKED) {
@@ -92,21 +173,41 @@ int main(int argc, char** argv) {
 					break;
 				case '\0':
 					break;
+				case KEY_RESIZE:
+					clear();
+					board.invalidate();
+					break;
+				case ERR:
+					printAnalysis(analysis, shownAnalysis, false);
+					refresh();
+					goto skip;
 				default:
 					goto skip;
 			}
 
-			clear();
-			printBoard(game, squareSelected, selectedSquare);
+			if (changed) {
+				analysis.start(game);
+				changed = false;
+			}
+
+			// the board only redraws what changed, the text lines are wiped one by one instead of clearing the whole screen
+			board.draw(game, squareSelected, selectedSquare);
+			for (int row : {24, 25, 26}) {
+				move(row, 0);
+				clrtoeol();
+			}
+			for (int row = 0; row < 5; row++) {
+				move(row, 64);
+				clrtoeol();
+			}
+
 			if (squareSelected) {
-				mvprintw(24, 0, to_string(selectedSquare).c_str());
+				mvprintw(24, 0, "%s", to_string(selectedSquare).c_str());
 			}
-			mvprintw(25, 0,
-					 game.turn() == Players::WHITE ? game.isChecked() ? "White to move (check!)" : "White to move"
-												   : game.isChecked() ? "Black to move (check!)" : "Black to move");
+			mvprintw(25, 0, "%s to move%s", game.turn() == Players::WHITE ? "White" : "Black", board.checked() ? " (check!)" : "");
 			if (error != "") {
 				attron(COLOR_PAIR(2));
-				mvprintw(26, 0, error.c_str());
+				mvprintw(26, 0, "%s", error.c_str());
 				attroff(COLOR_PAIR(2));
 			}
 			if (promoting) {
@@ -119,6 +220,7 @@ int main(int argc, char** argv) {
 			mvprintw(30, 0, "White is uppercase, black is lowercase");
 			mvprintw(31, 0, "Click to select a square, click again to move");
 			mvprintw(32, 0, "Middle/right click to deselect");
+			printAnalysis(analysis, shownAnalysis, true);
 			refresh();
 		skip:
 			void(0);
@@ -139,77 +241,175 @@ int main(int argc, char** argv) {
 	return 0;
 }
 
-void printBoard(const Game& game, bool squareSelected, const Position& selectedSquare) {
-	bool black = true;
+void Analysis::start(const Game& game) {
+	stop();
+
+	if (game.shouldPromote()) {
+		_publish("Analysis: waiting for a promotion piece", "");
+		return;
+	} else if (game.status() != GameStates::IN_PROGRESS) {
+		_publish("Analysis: game over", "");
+		return;
+	}
+
+	_publish("Analysis: searching...", "");
+	_stop = false;
+
+	_thread = thread([this, game]() {
+		try {
+			// no limits, so it runs until a mate is found, the depth cap, or the position changes
+			_searcher.search(game, {}, &_stop, [&](const SearchResult& progress) {
+				int white = game.turn() == Players::WHITE ? progress.score : -progress.score;
+				string score;
+				if (abs(white) > MATE_BOUND) {
+					score = string(white > 0 ? "white" : "black") + " mates in " + to_string((MATE - abs(white) + 1) / 2);
+				} else {
+					char buffer[16];
+					snprintf(buffer, sizeof(buffer), "%+.2f", white / 100.0);
+					score = buffer;
+				}
+
+				string pv;
+				Game line = game;
+				for (const Move& move : progress.pv) {
+					bool promotes = line.getPiece(move.from).type() == PieceTypes::PAWN && (move.to.rank == 1 || move.to.rank == 8);
+
+					pv += (pv.empty() ? "PV: " : " ") + encodeSAN(line, move, promotes ? PieceTypes::QUEEN : PieceTypes::PAWN);
+					if (line.move(move)) {
+						line.promote(move.to, PieceTypes::QUEEN);
+					}
+				}
+
+				_publish("Analysis: depth " + to_string(progress.depth) + ", " + score + ", " + to_string(progress.nodes) + " nodes, " +
+							 to_string(progress.nodes / max<uint64_t>(progress.milliseconds, 1)) + " kn/s",
+						 pv);
+			});
+
+			if (!_stop) {
+				string info, pv;
+				describe(info, pv);
+				_publish(info + " (done)", pv);
+			}
+		} catch (const exception& e) {
+			_publish("Analysis failed: " + string(e.what()), "");
+		}
+	});
+}
+
+void Analysis::stop() {
+	_stop = true;
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
 
-	vector<Move> availableMoves;
+uint64_t Analysis::version() {
+	lock_guard<mutex> lock(_mutex);
+	return _version;
+}
 
+void Analysis::describe(string& info, string& pv) {
+	lock_guard<mutex> lock(_mutex);
+	info = _info;
+	pv = _pv;
+}
+
+void Analysis::_publish(const string& info, const string& pv) {
+	lock_guard<mutex> lock(_mutex);
+	_info = info;
+	_pv = pv;
+	_version++;
+}
+
+void printAnalysis(Analysis& analysis, uint64_t& shown, bool force) {
+	uint64_t version = analysis.version();
+	if (!force && version == shown) {
+		return;
+	}
+
+	string info, pv;
+	analysis.describe(info, pv);
+	shown = version;
+
+	move(34, 0);
+	clrtoeol();
+	mvprintw(34, 0, "%s", info.substr(0, COLS).c_str());
+	move(35, 0);
+	clrtoeol();
+	mvprintw(35, 0, "%s", pv.substr(0, COLS).c_str());
+}
+
+void BoardView::draw(const Game& game, bool squareSelected, const Position& selectedSquare) {
+	if (!_drawn || game.key() != _cachedKey || game.turn() != _cachedTurn || game.shouldPromote() != _cachedPromotion) {
+		_cachedKey = game.key();
+		_cachedTurn = game.turn();
+		_cachedPromotion = game.shouldPromote();
+		_checked = game.isChecked();
+		_movesValid = false;
+	}
+
+	uint64_t targets = 0;
 	if (squareSelected) {
-		for (const Move& move : game.getAvailableMoves()) {
+		if (!_movesValid) {
+			_moves = game.getAvailableMoves();
+			_movesValid = true;
+		}
+
+		for (const Move& move : _moves) {
 			if (move.from == selectedSquare) {
-				availableMoves.push_back(move);
+				targets |= 1ull << squareOf(move.to);
 			}
 		}
 	}
 
-	for (Files file : FILES) {
-		for (uint rank = 1; rank <= 8; rank++) {
-			Position square = {.file = file, .rank = rank};
+	char symbols[64];
+	uint checkedKing = 64;
+	fill(symbols, symbols + 64, ' ');
+	for (Players player : {Players::WHITE, Players::BLACK}) {
+		for (const Piece& piece : game.pieces(player)) {
+			symbols[squareOf(piece.position())] = piece.symbol();
 
-			bool isMoveTarget = false;
-			for (const Move& move : availableMoves) {
-				if (move.to == square) {
-					isMoveTarget = true;
-					break;
-				}
+			if (_checked && piece.type() == PieceTypes::KING && player == game.turn()) {
+				checkedKing = squareOf(piece.position());
 			}
+		}
+	}
 
-			if (game.hasPiece(square)) {
-				try {
-					Piece piece = game.getPiece(square);
-
-					if (squareSelected && (square == selectedSquare || isMoveTarget)) {
-						if (square == selectedSquare)
-							attron(COLOR_PAIR(1));
-						else if (isMoveTarget)
-							attron(COLOR_PAIR(2));
-					} else if (game.isChecked() && piece.type() == PieceTypes::KING && piece.player() == game.turn())
-						attron(COLOR_PAIR(2));
-					else if (!black)
-						attron(A_REVERSE);
-
-					for (int i = 0; i < 3; i++) {
-						if (i == 1) {
-							mvprintw((8 - rank) * 3 + 1, file * 6, "  ");
-							addch(piece.symbol());
-							printw("   ");
-						} else {
-							mvprintw((8 - rank) * 3 + i, file * 6, "      ");
-						}
-					}
+	for (Files file : FILES) {
+		for (uint rank = 1; rank <= 8; rank++) {
+			Position square = {.file = file, .rank = rank};
+			uint idx = squareOf(square);
+			bool selected = squareSelected && square == selectedSquare, target = targets >> idx & 1, light = (file + rank) % 2 == 0;
 
-					attrset(A_NORMAL);
-				} catch (const runtime_error& e) {
-					throw runtime_error("Rendering error at position " + to_string(square) + ": " + string(e.what()));
-				} catch (...) {
-					throw runtime_error("Unknown rendering error");
+			Square want = {.symbol = symbols[idx], .attributes = A_NORMAL};
+			if (want.symbol == ' ') {
+				if (selected || target) {
+					want.attributes = COLOR_PAIR(1);
+				} else if (light) {
+					want.attributes = A_REVERSE;
 				}
 			} else {
-				if (squareSelected && (square == selectedSquare || isMoveTarget))
-					attron(COLOR_PAIR(1));
-				else if (!black)
-					attron(A_REVERSE);
-
-				for (int i = 0; i < 3; i++) {
-					mvprintw((8 - rank) * 3 + i, file * 6, "      ");
+				if (selected) {
+					want.attributes = COLOR_PAIR(1);
+				} else if (target || idx == checkedKing) {
+					want.attributes = COLOR_PAIR(2);
+				} else if (light) {
+					want.attributes = A_REVERSE;
 				}
+			}
 
-				attrset(A_NORMAL);
+			if (_drawn && want.symbol == _squares[idx].symbol && want.attributes == _squares[idx].attributes) {
+				continue;
 			}
+			_squares[idx] = want;
 
-			black = !black;
+			attrset(want.attributes);
+			for (int i = 0; i < 3; i++) {
+				mvprintw((8 - rank) * 3 + i, file * 6, i == 1 ? "  %c   " : "      ", want.symbol);
+			}
+			attrset(A_NORMAL);
 		}
-
-		black = !black;
 	}
+
+	_drawn = true;
 }
\ No newline at end of file
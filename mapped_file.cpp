@@ -0,0 +1,43 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+using namespace std;
+
+MappedFile::MappedFile(const string& path) : _data(nullptr), _size(0) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("Could not open " + path + ".");
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw runtime_error("Could not stat " + path + ".");
+	}
+
+	_size = info.st_size;
+	if (_size > 0) {
+		void* mapping = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			throw runtime_error("Could not map " + path + ".");
+		}
+
+		_data = (const unsigned char*)mapping;
+	}
+
+	close(fd);	// the mapping keeps its own reference to the file
+}
+
+MappedFile::~MappedFile() {
+	if (_data) {
+		munmap((void*)_data, _size);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// read-only mmap of a whole file; pages are loaded lazily by the OS and shared between processes reading the same file
+class MappedFile {
+public:
+	MappedFile(const std::string& path);
+	MappedFile(const MappedFile& other) = delete;
+	~MappedFile();
+
+	const unsigned char* data() const { return _data; }
+	size_t size() const { return _size; }
+
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+private:
+	const unsigned char* _data;
+	size_t _size;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,405 @@
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "bitbase.h"
+#include "chess.h"
+#include "nnue.h"
+#include "pgn.h"
+#include "search.h"
+#include "sprt.h"
+
+using namespace std;
+
+struct EngineConfig {
+	string name;
+	SearchLimits limits;
+	string network;	 // weights file, empty for the hand written evaluation
+};
+
+struct MatchConfig {
+	uint threads = max(1u, thread::hardware_concurrency());
+	uint rounds = 1;		// every opening is played twice per round, once with each engine as white
+	uint maxPlies = 400;	// then it's a draw
+	int resignScore = 1000;	// both engines agreeing a side is this far ahead for resignPlies plies in a row wins the game for it
+	uint resignPlies = 6;
+	int drawScore = 10;		// likewise scores this close to 0 for drawPlies plies in a row after drawAfter plies draw the game
+	uint drawPlies = 12;
+	uint drawAfter = 80;
+	string bitbases;
+	bool sprt = false;
+	double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+};
+
+// "a:b:c" -> {a, b, c}
+static vector<string> split(const string& value, char separator) {
+	vector<string> out;
+	stringstream stream(value);
+	string part;
+
+	while (getline(stream, part, separator)) {
+		out.push_back(part);
+	}
+
+	return out;
+}
+
+// comma separated key=value pairs: depth, nodes, movetime (ms), nnue (weights file) and name
+static EngineConfig parseEngine(const string& spec) {
+	EngineConfig engine = {.name = spec, .limits = {}, .network = ""};
+
+	for (const string& option : split(spec, ',')) {
+		size_t eq = option.find('=');
+		string key = option.substr(0, eq), value = eq == string::npos ? "" : option.substr(eq + 1);
+
+		if (key == "depth") {
+			engine.limits.depth = stoul(value);
+		} else if (key == "nodes") {
+			engine.limits.nodes = stoull(value);
+		} else if (key == "movetime") {
+			engine.limits.milliseconds = stoull(value);
+		} else if (key == "nnue") {
+			engine.network = value;
+		} else if (key == "name") {
+			engine.name = value;
+		} else {
+			throw runtime_error("Unknown engine option '" + key + "'.");
+		}
+	}
+
+	if (!engine.limits.depth && !engine.limits.nodes && !engine.limits.milliseconds) {
+		throw runtime_error("Engine '" + spec + "' needs a depth, nodes or movetime limit.");
+	}
+
+	return engine;
+}
+
+static void parseOption(const string& option, MatchConfig& config) {
+	size_t eq = option.find('=');
+	if (eq == string::npos) {
+		throw runtime_error("Expected key=value, got '" + option + "'.");
+	}
+
+	string key = option.substr(0, eq), value = option.substr(eq + 1);
+	vector<string> parts = split(value, ':');
+
+	if (key == "threads") {
+		config.threads = max(1ul, stoul(value));
+	} else if (key == "rounds") {
+		config.rounds = stoul(value);
+	} else if (key == "maxplies") {
+		config.maxPlies = stoul(value);
+	} else if (key == "resign" && parts.size() == 2) {
+		config.resignScore = stoi(parts[0]);
+		config.resignPlies = stoul(parts[1]);
+	} else if (key == "draw" && parts.size() == 3) {
+		config.drawScore = stoi(parts[0]);
+		config.drawPlies = stoul(parts[1]);
+		config.drawAfter = stoul(parts[2]);
+	} else if (key == "bitbases") {
+		config.bitbases = value;
+	} else if (key == "sprt" && (parts.size() == 2 || parts.size() == 4)) {
+		config.sprt = true;
+		config.elo0 = stod(parts[0]);
+		config.elo1 = stod(parts[1]);
+		if (parts.size() == 4) {
+			config.alpha = stod(parts[2]);
+			config.beta = stod(parts[3]);
+		}
+	} else {
+		throw runtime_error("Bad option '" + option + "'.");
+	}
+}
+
+// one line per opening (FEN or EPD), blank lines and lines starting with # are skipped
+static vector<string> readOpenings(const string& path) {
+	if (path == "-") {
+		return {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+	}
+
+	ifstream in(path);
+	if (!in) {
+		throw runtime_error("Could not open " + path + ".");
+	}
+
+	vector<string> openings;
+	string line;
+	while (getline(in, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		Game check(line);  // throws on a bad position now, rather than from a worker later
+		openings.push_back(line);
+	}
+
+	if (openings.empty()) {
+		throw runtime_error(path + " has no positions.");
+	}
+
+	return openings;
+}
+
+struct PlayedGame {
+	string fen;
+	vector<string> moves;  // SAN
+	string result;
+	string termination;
+	int startTurn;
+	Players startPlayer;
+};
+
+// plays from fen with white and black searching in turn until the game ends or an adjudication rule fires; false if stop was
+// raised first
+static bool playGame(const string& fen, Searcher& white, Searcher& black, const SearchLimits& whiteLimits, const SearchLimits& blackLimits,
+					 const MatchConfig& config, const Bitbases* bitbases, const atomic<bool>& stop, PlayedGame& played) {
+	Game game(fen);
+	white.clear();
+	black.clear();
+
+	played = {.fen = fen, .moves = {}, .result = "*", .termination = "", .startTurn = game.turns(), .startPlayer = game.turn()};
+
+	uint resignStreak = 0, drawStreak = 0;
+	int resignSign = 0;
+
+	auto finish = [&](Players winner, bool draw, const string& reason) {
+		played.result = draw ? "1/2-1/2" : winner == Players::WHITE ? "1-0" : "0-1";
+		played.termination = reason;
+		return true;
+	};
+
+	for (uint ply = 0;; ply++) {
+		Players mover = game.turn(), other = mover == Players::WHITE ? Players::BLACK : Players::WHITE;
+
+		switch (game.status()) {
+			case GameStates::CHECKMATE:
+				return finish(other, false, "checkmate");
+			case GameStates::STALEMATE:
+				return finish(mover, true, "stalemate");
+			case GameStates::REPETITION:
+				return finish(mover, true, "threefold repetition");
+			case GameStates::FIFTY_MOVES:
+				return finish(mover, true, "fifty move rule");
+			case GameStates::INSUFFICIENT_MATERIAL:
+				return finish(mover, true, "insufficient material");
+			case GameStates::IN_PROGRESS:
+				break;
+		}
+
+		if (bitbases) {
+			BitbaseResults probed = bitbases->probe(game);
+			if (probed == BitbaseResults::WIN || probed == BitbaseResults::LOSS) {
+				return finish(probed == BitbaseResults::WIN ? mover : other, false, "adjudicated by bitbase");
+			} else if (probed == BitbaseResults::DRAW) {
+				return finish(mover, true, "adjudicated by bitbase");
+			}
+		}
+
+		if (ply >= config.maxPlies) {
+			return finish(mover, true, "adjudicated, move limit");
+		}
+
+		SearchResult result = (mover == Players::WHITE ? white : black).search(game, mover == Players::WHITE ? whiteLimits : blackLimits, &stop);
+		if (stop) {
+			return false;
+		}
+
+		// scores from white's point of view, so both engines' opinions can be compared
+		int score = mover == Players::WHITE ? result.score : -result.score;
+		int sign = score >= config.resignScore ? 1 : score <= -config.resignScore ? -1 : 0;
+		resignStreak = sign != 0 && sign == resignSign ? resignStreak + 1 : sign != 0;
+		resignSign = sign;
+		drawStreak = abs(score) <= config.drawScore ? drawStreak + 1 : 0;
+
+		played.moves.push_back(encodeSAN(game, result.move, result.promotion));
+		if (game.move(result.move)) {
+			game.promote(result.move.to, result.promotion);
+		}
+
+		if (config.resignPlies && resignStreak >= config.resignPlies) {
+			return finish(resignSign > 0 ? Players::WHITE : Players::BLACK, false, "adjudicated, resignation");
+		}
+		if (config.drawPlies && ply + 1 >= config.drawAfter && drawStreak >= config.drawPlies) {
+			return finish(mover, true, "adjudicated, draw");
+		}
+	}
+}
+
+static void writeGame(ostream& out, const PlayedGame& game, const string& white, const string& black, uint round) {
+	out << "[Event \"match\"]\n";
+	out << "[Site \"?\"]\n";
+	out << "[Round \"" << round << "\"]\n";
+	out << "[White \"" << white << "\"]\n";
+	out << "[Black \"" << black << "\"]\n";
+	out << "[Result \"" << game.result << "\"]\n";
+	out << "[FEN \"" << game.fen << "\"]\n";
+	out << "[SetUp \"1\"]\n";
+	out << "[Termination \"" << game.termination << "\"]\n\n";
+
+	string line;
+	int turn = game.startTurn;
+	Players player = game.startPlayer;
+
+	auto add = [&](const string& token) {
+		if (!line.empty() && line.size() + 1 + token.size() > 80) {
+			out << line << '\n';
+			line.clear();
+		}
+		line += (line.empty() ? "" : " ") + token;
+	};
+
+	for (uint i = 0; i < game.moves.size(); i++) {
+		if (player == Players::WHITE) {
+			add(std::to_string(turn) + ".");
+		} else if (i == 0) {
+			add(std::to_string(turn) + "...");
+		}
+
+		add(game.moves[i]);
+
+		if (player == Players::BLACK) {
+			turn++;
+		}
+		player = player == Players::WHITE ? Players::BLACK : Players::WHITE;
+	}
+
+	add("{" + game.termination + "}");
+	add(game.result);
+	out << line << "\n\n";
+}
+
+int main(int argc, char** argv) {
+	if (argc < 5) {
+		cout << "Usage: " << argv[0] << " <openings.epd|-> <games.pgn> <engine A> <engine B> [option=value ...]" << endl;
+		cout << "  engines: comma separated depth=N, nodes=N, movetime=ms, nnue=weights file, name=NAME" << endl;
+		cout << "  options: threads=N, rounds=N, maxplies=N, resign=cp:plies, draw=cp:plies:after ply, bitbases=dir," << endl;
+		cout << "           sprt=elo0:elo1[:alpha:beta]" << endl;
+		return 1;
+	}
+
+	vector<string> openings;
+	EngineConfig engines[2];
+	MatchConfig config;
+	unique_ptr<Network> networks[2];
+	unique_ptr<Bitbases> bitbases;
+
+	try {
+		openings = readOpenings(argv[1]);
+		engines[0] = parseEngine(argv[3]);
+		engines[1] = parseEngine(argv[4]);
+		for (int i = 5; i < argc; i++) {
+			parseOption(argv[i], config);
+		}
+
+		for (uint e = 0; e < 2; e++) {
+			if (!engines[e].network.empty()) {
+				networks[e] = make_unique<Network>(engines[e].network);
+			}
+		}
+		if (!config.bitbases.empty()) {
+			bitbases = make_unique<Bitbases>(config.bitbases);
+		}
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+
+	ofstream pgn(argv[2]);
+	if (!pgn) {
+		cout << "Error: could not open " << argv[2] << " for writing." << endl;
+		return 1;
+	}
+
+	SPRT sprt(config.elo0, config.elo1, config.alpha, config.beta);
+	uint64_t totalGames = (uint64_t)openings.size() * 2 * config.rounds;
+	atomic<uint64_t> nextGame = 0;
+	atomic<bool> stop = false;
+
+	// engine A's score, guarded by lock along with the pgn file
+	mutex lock;
+	uint64_t wins = 0, draws = 0, losses = 0;
+	string error;
+
+	vector<thread> workers;
+	for (uint t = 0; t < config.threads; t++) {
+		workers.emplace_back([&]() {
+			Searcher searchers[2] = {Searcher(1 << 16, networks[0].get()), Searcher(1 << 16, networks[1].get())};
+			PlayedGame played;
+
+			for (uint64_t i; !stop && (i = nextGame++) < totalGames;) {
+				// pairs of games share an opening with colors swapped
+				const string& fen = openings[i / 2 % openings.size()];
+				uint a = i % 2, b = 1 - a;	// a is white's engine
+
+				try {
+					if (!playGame(fen, searchers[a], searchers[b], engines[a].limits, engines[b].limits, config, bitbases.get(), stop, played)) {
+						break;
+					}
+				} catch (const exception& e) {
+					lock_guard<mutex> guard(lock);
+					error = e.what();
+					stop = true;
+					break;
+				}
+
+				lock_guard<mutex> guard(lock);
+				writeGame(pgn, played, engines[a].name, engines[b].name, i / 2 + 1);
+				pgn.flush();
+
+				bool whiteWon = played.result == "1-0", blackWon = played.result == "0-1";
+				if (!whiteWon && !blackWon) {
+					draws++;
+				} else if (whiteWon == (a == 0)) {
+					wins++;
+				} else {
+					losses++;
+				}
+
+				EloEstimate elo = estimateElo(wins, draws, losses);
+				cout << "Game " << wins + draws + losses << "/" << totalGames << ": " << engines[a].name << " vs " << engines[b].name << " "
+					 << played.result << " (" << played.termination << ")  A +" << wins << " =" << draws << " -" << losses << "  Elo "
+					 << fixed << setprecision(1) << elo.elo << " +/- " << elo.margin;
+				if (config.sprt) {
+					cout << "  LLR " << setprecision(2) << sprt.llr(wins, draws, losses) << " [" << sprt.lowerBound() << ", "
+						 << sprt.upperBound() << "]";
+
+					if (sprt.test(wins, draws, losses) != SPRTResults::UNDECIDED) {
+						stop = true;
+					}
+				}
+				cout << endl;
+			}
+		});
+	}
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	if (!error.empty()) {
+		cout << "Error: " << error << endl;
+		return 1;
+	}
+
+	EloEstimate elo = estimateElo(wins, draws, losses);
+	cout << engines[0].name << " vs " << engines[1].name << ": +" << wins << " =" << draws << " -" << losses << ", Elo " << fixed
+		 << setprecision(1) << elo.elo << " +/- " << elo.margin << endl;
+
+	if (config.sprt) {
+		SPRTResults result = sprt.test(wins, draws, losses);
+		cout << "SPRT [" << config.elo0 << ", " << config.elo1 << "]: "
+			 << (result == SPRTResults::ACCEPT_H1 ? "H1 accepted" : result == SPRTResults::ACCEPT_H0 ? "H0 accepted" : "inconclusive")
+			 << endl;
+	}
+
+	return 0;
+}
\ No newline at end of file
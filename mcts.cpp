@@ -0,0 +1,324 @@
+#include "mcts.h"
+
+#include <cmath>
+#include <memory>
+#include <thread>
+
+#include "eval.h"
+
+using namespace std;
+
+// centipawns per unit of atanh(value), 400 puts a pawn up at about 0.25
+const double VALUE_CENTIPAWNS = 400;
+
+// centipawns per unit of prior logit, lower concentrates the priors on the best looking moves
+const double PRIOR_CENTIPAWNS = 200;
+
+// unvisited children start at their parent's value minus this, so visited moves that hold up get searched deeper first
+const double FIRST_PLAY_REDUCTION = 0.2;
+
+// playouts are capped this deep, the position there is scored as a leaf
+const uint MAX_PLAYOUT_DEPTH = 256;
+
+// how often (in playouts) the clock is read
+const uint64_t CLOCK_CHECK_INTERVAL = 256;
+
+static Position positionOf(uint square) {
+	return {.file = (Files)(square % 8), .rank = square / 8 + 1};
+}
+
+static double valueOfScore(int centipawns) {
+	return tanh(centipawns / VALUE_CENTIPAWNS);
+}
+
+static int scoreOfValue(double value) {
+	return (int)lround(atanh(clamp(value, -0.999, 0.999)) * VALUE_CENTIPAWNS);
+}
+
+MCTSNodePool::MCTSNodePool(size_t capacity) : _nodes(min<size_t>(max<size_t>(capacity, 1), NO_NODE)), _used(0) {}
+
+uint32_t MCTSNodePool::allocate(uint32_t count) {
+	uint64_t first = _used.fetch_add(count, memory_order_relaxed);
+
+	return first + count <= _nodes.size() ? first : NO_NODE;
+}
+
+MCTS::MCTS(size_t nodes, const Network* network, double exploration)
+	: _pool(nodes), _network(network), _exploration(exploration), _stop(nullptr), _playouts(0), _done(false) {}
+
+double MCTS::_evaluate(const Game& game, PawnTable& pawns) const {
+	return valueOfScore(_network ? _network->evaluate(game) : evaluate(game, pawns));
+}
+
+bool MCTS::_expand(uint32_t idx, const Game& game, PawnTable& pawns) {
+	MCTSNode& node = _pool[idx];
+
+	uint8_t expected = ExpansionStates::UNEXPANDED;
+	if (!node.state.compare_exchange_strong(expected, ExpansionStates::EXPANDING, memory_order_acquire)) {
+		return false;
+	}
+
+	struct Legal {
+		Move move;
+		PieceTypes promotion;
+		double logit;
+	};
+
+	MoveList candidates;
+	game._candidateMoves(candidates);
+
+	Legal legal[MAX_MOVES];
+	uint count = 0;
+	double maxLogit = -INFINITY;
+	Game child;
+
+	// the children's priors come from the node's accumulator with each move applied, not a refresh per child
+	Accumulator parent, acc;
+	if (_network) {
+		_network->refresh(parent, game);
+	}
+
+	for (const Move& move : candidates) {
+		try {
+			child = game.branch(move);
+		} catch (...) {
+			continue;
+		}
+
+		PieceTypes promotion = PieceTypes::PAWN;
+		if (child.shouldPromote()) {
+			promotion = PieceTypes::QUEEN;
+			child.promote(move.to, PieceTypes::QUEEN);
+		}
+
+		int score;
+		if (_network) {
+			_network->update(acc, parent, game, child, move);
+			score = _network->evaluate(acc, child.turn());
+		} else {
+			score = evaluate(child, pawns);
+		}
+
+		double logit = -score / PRIOR_CENTIPAWNS;
+		maxLogit = max(maxLogit, logit);
+		legal[count++] = {.move = move, .promotion = promotion, .logit = logit};
+	}
+
+	if (count == 0) {
+		node.state.store(ExpansionStates::TERMINAL, memory_order_release);
+		return true;
+	}
+
+	uint32_t first = _pool.allocate(count);
+	if (first == NO_NODE) {
+		node.state.store(ExpansionStates::UNEXPANDED, memory_order_release);
+		return false;
+	}
+
+	double total = 0;
+	for (uint i = 0; i < count; i++) {
+		total += legal[i].logit = exp(legal[i].logit - maxLogit);
+	}
+
+	for (uint i = 0; i < count; i++) {
+		MCTSNode& out = _pool[first + i];
+
+		out.valueSum.store(0, memory_order_relaxed);
+		out.visits.store(0, memory_order_relaxed);
+		out.virtualLoss.store(0, memory_order_relaxed);
+		out.firstChild = NO_NODE;
+		out.prior = legal[i].logit / total;
+		out.childCount = 0;
+		out.from = squareOf(legal[i].move.from);
+		out.to = squareOf(legal[i].move.to);
+		out.promotion = legal[i].promotion;
+		out.state.store(ExpansionStates::UNEXPANDED, memory_order_relaxed);
+	}
+
+	node.firstChild = first;
+	node.childCount = count;
+	node.state.store(ExpansionStates::EXPANDED, memory_order_release);
+
+	return true;
+}
+
+uint32_t MCTS::_select(uint32_t parentIdx) const {
+	const MCTSNode& parent = _pool[parentIdx];
+
+	uint32_t parentVisits = parent.visits.load(memory_order_relaxed);
+	double explore = _exploration * sqrt((double)parentVisits + 1);
+
+	// the parent's value is stored for the player who moved into it, its children's for the player to move there
+	double firstPlay = parentVisits ? -(double)parent.valueSum.load(memory_order_relaxed) / MCTS_VALUE_SCALE / parentVisits : 0;
+	firstPlay -= FIRST_PLAY_REDUCTION;
+
+	uint32_t best = parent.firstChild;
+	double bestScore = -INFINITY;
+
+	for (uint32_t idx = parent.firstChild; idx < parent.firstChild + parent.childCount; idx++) {
+		const MCTSNode& child = _pool[idx];
+
+		uint32_t visits = child.visits.load(memory_order_relaxed), virtualLoss = child.virtualLoss.load(memory_order_relaxed);
+		uint32_t n = visits + virtualLoss;
+
+		// every thread still below the child counts as a lost playout
+		double q = n ? ((double)child.valueSum.load(memory_order_relaxed) / MCTS_VALUE_SCALE - virtualLoss) / n : firstPlay;
+		double score = q + explore * child.prior / (1 + n);
+
+		if (score > bestScore) {
+			bestScore = score;
+			best = idx;
+		}
+	}
+
+	return best;
+}
+
+bool MCTS::_playout(const Game& root, PawnTable& pawns) {
+	Game game = root;
+	uint32_t path[MAX_PLAYOUT_DEPTH];
+	uint length = 0;
+	uint32_t idx = 0;
+	double value;  // for the side to move at the last node of the path
+	bool full = false;
+
+	path[length++] = idx;
+
+	for (;;) {
+		MCTSNode& node = _pool[idx];
+
+		// like the alpha-beta search, any repeat inside the tree is a draw
+		if (length > 1 && (game.repetitions() >= 1 || game.halfTurnsSinceCapture() >= 100)) {
+			value = 0;
+			break;
+		}
+
+		uint8_t state = node.state.load(memory_order_acquire);
+		if (state == ExpansionStates::UNEXPANDED) {
+			if (!_expand(idx, game, pawns) && node.state.load(memory_order_acquire) == ExpansionStates::UNEXPANDED) {
+				full = true;
+			}
+			state = node.state.load(memory_order_acquire);
+		}
+
+		if (state == ExpansionStates::TERMINAL) {
+			value = game.isChecked() ? -1 : 0;
+			break;
+		}
+		// just expanded (by this thread or one that got there first), or as deep as a playout goes
+		if (state != ExpansionStates::EXPANDED || node.visits.load(memory_order_relaxed) == 0 || length == MAX_PLAYOUT_DEPTH) {
+			value = _evaluate(game, pawns);
+			break;
+		}
+
+		idx = _select(idx);
+		MCTSNode& child = _pool[idx];
+		child.virtualLoss.fetch_add(1, memory_order_relaxed);
+		path[length++] = idx;
+
+		Position to = positionOf(child.to);
+		if (game.move({.from = positionOf(child.from), .to = to})) {
+			game.promote(to, (PieceTypes)child.promotion);
+		}
+	}
+
+	// back up, each node's value being for the player who moved into it
+	for (uint i = length; i-- > 0;) {
+		MCTSNode& node = _pool[path[i]];
+		value = -value;
+
+		node.valueSum.fetch_add(llround(value * MCTS_VALUE_SCALE), memory_order_relaxed);
+		node.visits.fetch_add(1, memory_order_relaxed);
+		if (i > 0) {
+			node.virtualLoss.fetch_sub(1, memory_order_relaxed);
+		}
+	}
+
+	return !full;
+}
+
+void MCTS::_worker(const Game& root, PawnTable& pawns) {
+	while (!_done.load(memory_order_relaxed)) {
+		if (!_playout(root, pawns)) {
+			_done = true;
+			break;
+		}
+
+		uint64_t playouts = _playouts.fetch_add(1, memory_order_relaxed) + 1;
+
+		if ((_limits.nodes && playouts >= _limits.nodes) || (_stop && _stop->load(memory_order_relaxed))) {
+			_done = true;
+		} else if (_limits.milliseconds && playouts % CLOCK_CHECK_INTERVAL == 0 &&
+				   chrono::steady_clock::now() - _start >= chrono::milliseconds(_limits.milliseconds)) {
+			_done = true;
+		}
+	}
+}
+
+MCTSResult MCTS::search(const Game& game, const SearchLimits& limits, uint threads, const atomic<bool>* stop) {
+	if (game.shouldPromote()) {
+		throw runtime_error("Select a promotion piece before searching.");
+	}
+
+	_limits = limits;
+	_stop = stop;
+	_start = chrono::steady_clock::now();
+	_playouts = 0;
+	_done = false;
+
+	_pool.clear();
+	uint32_t rootIdx = _pool.allocate(1);
+	MCTSNode& root = _pool[rootIdx];
+	root.valueSum = 0;
+	root.visits = 0;
+	root.virtualLoss = 0;
+	root.firstChild = NO_NODE;
+	root.childCount = 0;
+	root.state = ExpansionStates::UNEXPANDED;
+
+	// each thread gets its own pawn hash, they're not thread safe
+	vector<unique_ptr<PawnTable>> pawns;
+	for (uint t = 0; t < max(threads, 1u); t++) {
+		pawns.push_back(make_unique<PawnTable>());
+	}
+
+	_expand(rootIdx, game, *pawns[0]);
+	if (root.state != ExpansionStates::EXPANDED) {
+		throw runtime_error(root.state == ExpansionStates::TERMINAL ? "No legal moves to search." : "Node pool too small to search.");
+	}
+
+	vector<thread> helpers;
+	for (uint t = 1; t < pawns.size(); t++) {
+		helpers.emplace_back([this, &game, &pawns, t]() { _worker(game, *pawns[t]); });
+	}
+	_worker(game, *pawns[0]);
+	for (thread& helper : helpers) {
+		helper.join();
+	}
+
+	MCTSResult result = {.move = {}, .promotion = PieceTypes::PAWN, .score = 0, .playouts = _playouts, .milliseconds = 0, .distribution = {}};
+
+	for (uint32_t idx = root.firstChild; idx < root.firstChild + root.childCount; idx++) {
+		const MCTSNode& child = _pool[idx];
+		uint32_t visits = child.visits;
+
+		result.distribution.push_back({.move = {.from = positionOf(child.from), .to = positionOf(child.to)},
+									   .promotion = (PieceTypes)child.promotion,
+									   .visits = visits,
+									   .value = visits ? (double)child.valueSum / MCTS_VALUE_SCALE / visits : 0,
+									   .prior = child.prior});
+	}
+
+	// ties (only before anything was visited, really) go to the higher prior
+	stable_sort(result.distribution.begin(), result.distribution.end(), [](const MoveVisits& a, const MoveVisits& b) {
+		return a.visits != b.visits ? a.visits > b.visits : a.prior > b.prior;
+	});
+
+	const MoveVisits& best = result.distribution[0];
+	result.move = best.move;
+	result.promotion = best.promotion;
+	result.score = scoreOfValue(best.visits ? best.value : 0);
+	result.milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - _start).count();
+
+	return result;
+}
\ No newline at end of file
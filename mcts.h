@@ -0,0 +1,122 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "chess.h"
+#include "nnue.h"
+#include "search.h"
+
+const uint32_t NO_NODE = UINT32_MAX;
+
+// fixed point scale of the value sums, values are in [-1, 1] for the player who made the move into the node
+const int64_t MCTS_VALUE_SCALE = 1 << 16;
+
+enum ExpansionStates : uint8_t { UNEXPANDED, EXPANDING, EXPANDED, TERMINAL };
+
+// 32 bytes, two to a cache line
+struct MCTSNode {
+	std::atomic<int64_t> valueSum;		// MCTS_VALUE_SCALE fixed point
+	std::atomic<uint32_t> visits;
+	std::atomic<uint32_t> virtualLoss;	// threads currently below this node, each counting as a lost playout until it backs up
+	uint32_t firstChild;				// children are contiguous in the pool, valid once state is EXPANDED
+	float prior;
+	uint16_t childCount;
+	uint8_t from;  // squareOf, the move that led here
+	uint8_t to;
+	uint8_t promotion;	// PieceTypes, PAWN unless the move promotes
+	std::atomic<uint8_t> state;	 // ExpansionStates
+};
+
+/*
+ * Nodes for a whole search, allocated up front in one array and handed out by bumping an atomic index, so expanding a node is
+ * a single fetch_add and a node's children sit next to each other in memory. Nothing is freed on its own; clear() makes all of
+ * it available again.
+ */
+class MCTSNodePool {
+public:
+	MCTSNodePool(size_t capacity);
+
+	// index of the first of count consecutive nodes, NO_NODE when the pool is full
+	uint32_t allocate(uint32_t count);
+
+	MCTSNode& operator[](uint32_t idx) { return _nodes[idx]; }
+	const MCTSNode& operator[](uint32_t idx) const { return _nodes[idx]; }
+
+	size_t size() const { return std::min<size_t>(_used.load(std::memory_order_relaxed), _nodes.size()); }
+	size_t capacity() const { return _nodes.size(); }
+
+	void clear() { _used = 0; }
+
+private:
+	std::vector<MCTSNode> _nodes;
+	std::atomic<uint64_t> _used;
+};
+
+struct MoveVisits {
+	Move move;
+	PieceTypes promotion;  // PAWN unless move promotes
+	uint32_t visits;
+	double value;  // mean playout value in [-1, 1] for the side to move, 0 if never visited
+	float prior;
+};
+
+struct MCTSResult {
+	Move move;	// most visited
+	PieceTypes promotion;
+	int score;	// centipawns for the side to move, converted back from the move's mean value
+	uint64_t playouts;
+	uint64_t milliseconds;
+	std::vector<MoveVisits> distribution;  // every legal root move, most visited first
+};
+
+/*
+ * Monte Carlo tree search with PUCT selection, run by several threads on one shared tree. Leaves are scored with the static
+ * evaluation (or a network) squashed into [-1, 1] instead of random rollouts, and expanded lazily: a node only gets children once
+ * a playout reaches it, with priors from a softmax over the evaluations of the children. Threads add virtual loss on their way
+ * down so they spread over different lines, and every counter is atomic, so there are no locks. The per-move visit distribution
+ * is the main output, the move is just its mode.
+ */
+class MCTS {
+public:
+	// nodes is the size of the node pool, which caps the tree (a search stops early once it's full)
+	MCTS(size_t nodes = 1 << 20, const Network* network = nullptr, double exploration = 1.5);
+
+	// limits.nodes counts playouts and limits.depth is ignored; with no limit at all it stops when the pool fills up. Throws like
+	// Searcher::search
+	MCTSResult search(const Game& game, const SearchLimits& limits, uint threads = 1, const std::atomic<bool>* stop = nullptr);
+
+	size_t treeSize() const { return _pool.size(); }
+
+private:
+	MCTSNodePool _pool;
+	const Network* _network;
+	double _exploration;
+
+	SearchLimits _limits;
+	const std::atomic<bool>* _stop;
+	std::chrono::steady_clock::time_point _start;
+	std::atomic<uint64_t> _playouts;
+	std::atomic<bool> _done;
+
+	// one thread's share of the search, pawns being its own pawn hash
+	void _worker(const Game& root, PawnTable& pawns);
+
+	// runs a single playout from the root, false once the pool ran out
+	bool _playout(const Game& root, PawnTable& pawns);
+
+	// child with the highest PUCT score
+	uint32_t _select(uint32_t parent) const;
+
+	// generates node's children if nobody did yet; false (node stays a leaf for now) if another thread is at it or the pool is full
+	bool _expand(uint32_t node, const Game& game, PawnTable& pawns);
+
+	// side to move's value of a position that isn't expanded yet
+	double _evaluate(const Game& game, PawnTable& pawns) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#include "chess.h"
+
+using namespace std;
+
+// every heap allocation in the program goes through here, so the benchmarks can count them
+static uint64_t allocations = 0;
+
+void* operator new(size_t bytes) {
+	allocations++;
+
+	if (void* ptr = malloc(bytes ? bytes : 1)) {
+		return ptr;
+	}
+	throw bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+struct CorpusPosition {
+	const char* category;
+	const char* fen;
+};
+
+// fixed so numbers stay comparable between commits, a few of each kind
+const CorpusPosition CORPUS[] = {
+	{"opening", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"},
+	{"opening", "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5"},
+	{"opening", "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3"},
+	{"middlegame", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"},
+	{"middlegame", "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 2 8"},
+	{"middlegame", "2rq1rk1/pb1nbppp/1p2pn2/2pp4/3P4/1P1BPN2/PBPN1PPP/2RQ1RK1 w - - 0 11"},
+	{"endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"},
+	{"endgame", "8/8/4k3/8/2K5/8/3P4/8 w - - 0 1"},
+	{"endgame", "6k1/5p2/6p1/8/7P/6P1/r4PK1/1R6 b - - 0 40"},
+	{"tactical", "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4"},
+	{"tactical", "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1"},
+	{"tactical", "r2q1rk1/ppp2ppp/2n5/3Np3/2B1n1b1/5N2/PPPP1PPP/R1BQR1K1 b - - 0 9"},
+};
+
+const char* CATEGORIES[] = {"opening", "middlegame", "endgame", "tactical"};
+
+enum Formats { TEXT, JSON, CSV };
+
+struct BenchConfig {
+	uint runs = 10;				// samples per benchmark, the statistics are over these
+	uint64_t minNanoseconds = 20000000;	 // each sample repeats the operation over its positions until at least this long
+	Formats format = Formats::TEXT;
+	string filter;	// only operations containing this
+};
+
+struct BenchResult {
+	string operation;
+	string category;
+	double minimum;	 // ns/op over the samples
+	double median;
+	double mean;
+	double stddev;
+	double allocations;	 // per op
+	uint64_t ops;		 // per sample
+};
+
+static void parseOption(const string& option, BenchConfig& config) {
+	size_t eq = option.find('=');
+	if (eq == string::npos) {
+		throw runtime_error("Expected key=value, got '" + option + "'.");
+	}
+
+	string key = option.substr(0, eq), value = option.substr(eq + 1);
+
+	if (key == "runs") {
+		config.runs = max(1ul, stoul(value));
+	} else if (key == "mintime") {
+		config.minNanoseconds = stoull(value) * 1000000;
+	} else if (key == "format") {
+		if (value == "text") {
+			config.format = Formats::TEXT;
+		} else if (value == "json") {
+			config.format = Formats::JSON;
+		} else if (value == "csv") {
+			config.format = Formats::CSV;
+		} else {
+			throw runtime_error("Unknown format '" + value + "'.");
+		}
+	} else if (key == "filter") {
+		config.filter = value;
+	} else {
+		throw runtime_error("Bad option '" + option + "'.");
+	}
+}
+
+// the positions of a category with everything the operations need precomputed
+struct Prepared {
+	vector<string> fens;
+	vector<Game> games;
+	vector<Move> moves;	 // a legal move in each game (the middle one, to avoid always hitting the first piece)
+};
+
+static Prepared prepare(const string& category) {
+	Prepared out;
+
+	for (const CorpusPosition& position : CORPUS) {
+		if (category != position.category) {
+			continue;
+		}
+
+		Game game(position.fen);
+		vector<Move> moves = game.getAvailableMoves();
+		if (moves.empty()) {
+			throw runtime_error(string("Corpus position without moves: ") + position.fen);
+		}
+
+		out.fens.push_back(position.fen);
+		out.games.push_back(game);
+		out.moves.push_back(moves[moves.size() / 2]);
+	}
+
+	return out;
+}
+
+// op(i) runs the operation on the ith position and returns something that depends on the work, so it can't be optimized out
+static BenchResult measure(const string& operation, const string& category, size_t positions, const function<uint64_t(size_t idx)>& op,
+						   const BenchConfig& config) {
+	volatile uint64_t sink = 0;
+
+	// warm up and find how many passes over the positions fill a sample
+	uint64_t passes = 1;
+	for (;;) {
+		auto start = chrono::steady_clock::now();
+		for (uint64_t pass = 0; pass < passes; pass++) {
+			for (size_t i = 0; i < positions; i++) {
+				sink = sink + op(i);
+			}
+		}
+		uint64_t elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+		if (elapsed >= config.minNanoseconds) {
+			break;
+		}
+		passes = elapsed ? max(passes * 2, (uint64_t)(passes * 1.1 * config.minNanoseconds / elapsed)) : passes * 2;
+	}
+
+	uint64_t ops = passes * positions, allocated = 0;
+	vector<double> samples;
+
+	for (uint run = 0; run < config.runs; run++) {
+		uint64_t before = allocations;
+		auto start = chrono::steady_clock::now();
+		for (uint64_t pass = 0; pass < passes; pass++) {
+			for (size_t i = 0; i < positions; i++) {
+				sink = sink + op(i);
+			}
+		}
+		uint64_t elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+		allocated += allocations - before;
+		samples.push_back((double)elapsed / ops);
+	}
+
+	sort(samples.begin(), samples.end());
+
+	double mean = 0, variance = 0;
+	for (double sample : samples) {
+		mean += sample / samples.size();
+	}
+	for (double sample : samples) {
+		variance += (sample - mean) * (sample - mean) / max<size_t>(samples.size() - 1, 1);
+	}
+
+	size_t middle = samples.size() / 2;
+
+	return {.operation = operation,
+			.category = category,
+			.minimum = samples[0],
+			.median = samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2,
+			.mean = mean,
+			.stddev = sqrt(variance),
+			.allocations = (double)allocated / (ops * config.runs),
+			.ops = ops};
+}
+
+static vector<BenchResult> runAll(const BenchConfig& config) {
+	vector<BenchResult> results;
+
+	for (const char* category : CATEGORIES) {
+		Prepared prepared = prepare(category);
+		const vector<Game>& games = prepared.games;
+		const vector<Move>& moves = prepared.moves;
+		size_t n = games.size();
+
+		// move works in place, so it gets a fresh copy every time, measured on its own as "copy"; the copies go to scratch
+		// rather than a local so the compiler can't shrink them to the fields that are read afterwards
+		Game scratch;
+		vector<pair<string, function<uint64_t(size_t)>>> operations = {
+			{"getAvailableMoves", [&](size_t i) { return games[i].getAvailableMoves().size(); }},
+			{"copy", [&](size_t i) { scratch = games[i]; return scratch.key(); }},
+			{"move", [&](size_t i) { scratch = games[i]; scratch.move(moves[i]); return scratch.key(); }},
+			{"branch", [&](size_t i) { return games[i].branch(moves[i]).key(); }},
+			{"isChecked", [&](size_t i) { return (uint64_t)games[i].isChecked(); }},
+			{"Game(fen)", [&](size_t i) { return Game(prepared.fens[i]).key(); }},
+			{"dumpFEN", [&](size_t i) { return games[i].dumpFEN().size(); }},
+		};
+
+		for (const auto& [name, op] : operations) {
+			if (name.find(config.filter) != string::npos) {
+				results.push_back(measure(name, category, n, op, config));
+			}
+		}
+	}
+
+	return results;
+}
+
+static void print(const vector<BenchResult>& results, const BenchConfig& config) {
+	switch (config.format) {
+		case Formats::TEXT:
+			cout << left << setw(18) << "operation" << setw(12) << "category" << right << setw(12) << "median ns" << setw(12) << "min ns"
+				 << setw(12) << "mean ns" << setw(10) << "stddev" << setw(12) << "allocs/op" << endl;
+			for (const BenchResult& result : results) {
+				cout << left << setw(18) << result.operation << setw(12) << result.category << right << fixed << setprecision(1) << setw(12)
+					 << result.median << setw(12) << result.minimum << setw(12) << result.mean << setw(10) << result.stddev << setprecision(2)
+					 << setw(12) << result.allocations << endl;
+			}
+			break;
+		case Formats::JSON:
+			cout << "[" << endl;
+			for (size_t i = 0; i < results.size(); i++) {
+				const BenchResult& result = results[i];
+				cout << fixed << setprecision(3) << "  {\"operation\": \"" << result.operation << "\", \"category\": \"" << result.category
+					 << "\", \"runs\": " << config.runs << ", \"ops_per_run\": " << result.ops << ", \"median_ns\": " << result.median
+					 << ", \"min_ns\": " << result.minimum << ", \"mean_ns\": " << result.mean << ", \"stddev_ns\": " << result.stddev
+					 << ", \"allocs_per_op\": " << result.allocations << "}" << (i + 1 < results.size() ? "," : "") << endl;
+			}
+			cout << "]" << endl;
+			break;
+		case Formats::CSV:
+			cout << "operation,category,runs,ops_per_run,median_ns,min_ns,mean_ns,stddev_ns,allocs_per_op" << endl;
+			for (const BenchResult& result : results) {
+				cout << fixed << setprecision(3) << result.operation << "," << result.category << "," << config.runs << "," << result.ops << ","
+					 << result.median << "," << result.minimum << "," << result.mean << "," << result.stddev << "," << result.allocations << endl;
+			}
+			break;
+	}
+}
+
+int main(int argc, char** argv) {
+	BenchConfig config;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			parseOption(argv[i], config);
+		}
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		cout << "Usage: " << argv[0] << " [option=value ...]" << endl;
+		cout << "  options: runs=N (default 10), mintime=ms per run (default 20), format=text|json|csv, filter=operation name" << endl;
+		return 1;
+	}
+
+	try {
+		print(runAll(config), config);
+	} catch (const exception& e) {
+		cout << "Error: " << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "nnue.h"
+
+#include <cstring>
+#include <fstream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+using namespace std;
+
+// black sees the board flipped vertically, so both perspectives share the same weights
+static uint featureIndex(Players perspective, uint kingSquare, const Piece& piece) {
+	uint square = squareOf(piece.position());
+
+	if (perspective == Players::BLACK) {
+		kingSquare ^= 56;
+		square ^= 56;
+	}
+
+	uint kind = piece.type() * 2 + (piece.player() == perspective ? 0 : 1);
+
+	return kingSquare * NNUE_PIECE_FEATURES + 1 + kind * 64 + square;
+}
+
+static uint kingSquareOf(const Game& game, Players player) {
+	for (const Piece& piece : game.pieces(player)) {
+		if (piece.type() == PieceTypes::KING) {
+			return squareOf(piece.position());
+		}
+	}
+
+	throw runtime_error("Shit done fucked up (no king for NNUE perspective)");
+}
+
+void nnueAddColumnScalar(int16_t* acc, const int16_t* weights) {
+	for (uint i = 0; i < NNUE_HIDDEN; i++) {
+		acc[i] += weights[i];
+	}
+}
+
+void nnueSubColumnScalar(int16_t* acc, const int16_t* weights) {
+	for (uint i = 0; i < NNUE_HIDDEN; i++) {
+		acc[i] -= weights[i];
+	}
+}
+
+int32_t nnueClippedDotScalar(const int16_t* acc, const int16_t* weights) {
+	int32_t sum = 0;
+
+	for (uint i = 0; i < NNUE_HIDDEN; i++) {
+		int16_t clipped = acc[i] < 0 ? 0 : acc[i] > NNUE_QA ? NNUE_QA : acc[i];
+		sum += clipped * weights[i];
+	}
+
+	return sum;
+}
+
+void nnueAddColumn(int16_t* acc, const int16_t* weights) {
+#if defined(__AVX2__)
+	for (uint i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i sum = _mm256_add_epi16(_mm256_load_si256((const __m256i*)(acc + i)), _mm256_loadu_si256((const __m256i*)(weights + i)));
+		_mm256_store_si256((__m256i*)(acc + i), sum);
+	}
+#elif defined(__SSE4_1__)
+	for (uint i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i sum = _mm_add_epi16(_mm_load_si128((const __m128i*)(acc + i)), _mm_loadu_si128((const __m128i*)(weights + i)));
+		_mm_store_si128((__m128i*)(acc + i), sum);
+	}
+#else
+	nnueAddColumnScalar(acc, weights);
+#endif
+}
+
+void nnueSubColumn(int16_t* acc, const int16_t* weights) {
+#if defined(__AVX2__)
+	for (uint i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i diff = _mm256_sub_epi16(_mm256_load_si256((const __m256i*)(acc + i)), _mm256_loadu_si256((const __m256i*)(weights + i)));
+		_mm256_store_si256((__m256i*)(acc + i), diff);
+	}
+#elif defined(__SSE4_1__)
+	for (uint i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i diff = _mm_sub_epi16(_mm_load_si128((const __m128i*)(acc + i)), _mm_loadu_si128((const __m128i*)(weights + i)));
+		_mm_store_si128((__m128i*)(acc + i), diff);
+	}
+#else
+	nnueSubColumnScalar(acc, weights);
+#endif
+}
+
+int32_t nnueClippedDot(const int16_t* acc, const int16_t* weights) {
+#if defined(__AVX2__)
+	const __m256i zero = _mm256_setzero_si256(), ceiling = _mm256_set1_epi16(NNUE_QA);
+	__m256i sum = _mm256_setzero_si256();
+
+	for (uint i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i clipped = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(acc + i)), zero), ceiling);
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(clipped, _mm256_loadu_si256((const __m256i*)(weights + i))));
+	}
+
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+
+	return _mm_cvtsi128_si32(half);
+#elif defined(__SSE4_1__)
+	const __m128i zero = _mm_setzero_si128(), ceiling = _mm_set1_epi16(NNUE_QA);
+	__m128i sum = _mm_setzero_si128();
+
+	for (uint i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i clipped = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)(acc + i)), zero), ceiling);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(clipped, _mm_loadu_si128((const __m128i*)(weights + i))));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+	return _mm_cvtsi128_si32(sum);
+#else
+	return nnueClippedDotScalar(acc, weights);
+#endif
+}
+
+static void readBytes(ifstream& in, unsigned char* out, size_t size, const string& path) {
+	in.read((char*)out, size);
+
+	if (!in) {
+		throw runtime_error("Network file " + path + " is truncated.");
+	}
+}
+
+static uint32_t readUint32(ifstream& in, const string& path) {
+	unsigned char bytes[4];
+	readBytes(in, bytes, 4, path);
+
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void readInt16s(ifstream& in, vector<int16_t>& out, const string& path) {
+	vector<unsigned char> bytes(out.size() * 2);
+	readBytes(in, bytes.data(), bytes.size(), path);
+
+	for (size_t i = 0; i < out.size(); i++) {
+		out[i] = (int16_t)(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+	}
+}
+
+Network::Network(const string& path)
+	: _featureWeights(NNUE_INPUTS * NNUE_HIDDEN), _featureBiases(NNUE_HIDDEN), _outputWeights(2 * NNUE_HIDDEN), _outputBias(0) {
+	ifstream in(path, ios::binary);
+
+	if (!in) {
+		throw runtime_error("Could not open network file " + path + ".");
+	}
+
+	char magic[4];
+	in.read(magic, 4);
+	if (!in || memcmp(magic, "CENN", 4) != 0) {
+		throw runtime_error("Network file " + path + " is not a CENN network.");
+	}
+
+	uint32_t version = readUint32(in, path), inputs = readUint32(in, path), hidden = readUint32(in, path);
+	if (version != 1) {
+		throw runtime_error("Network file " + path + " has unsupported version " + to_string(version) + ".");
+	}
+	if (inputs != NNUE_INPUTS || hidden != NNUE_HIDDEN) {
+		throw runtime_error("Network file " + path + " is " + to_string(inputs) + "x" + to_string(hidden) + ", expected " + to_string(NNUE_INPUTS) +
+							"x" + to_string(NNUE_HIDDEN) + ".");
+	}
+
+	readInt16s(in, _featureBiases, path);
+	readInt16s(in, _featureWeights, path);
+	readInt16s(in, _outputWeights, path);
+	_outputBias = (int32_t)readUint32(in, path);
+
+	if (in.peek() != ifstream::traits_type::eof()) {
+		throw runtime_error("Network file " + path + " has trailing data.");
+	}
+}
+
+void Network::refresh(Accumulator& acc, const Game& game) const {
+	refresh(acc, game, Players::WHITE);
+	refresh(acc, game, Players::BLACK);
+}
+
+void Network::refresh(Accumulator& acc, const Game& game, Players perspective) const {
+	uint kingSquare = kingSquareOf(game, perspective);
+
+	memcpy(acc.values[perspective], _featureBiases.data(), sizeof(acc.values[perspective]));
+
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		for (const Piece& piece : game.pieces(player)) {
+			if (piece.type() != PieceTypes::KING) {
+				nnueAddColumn(acc.values[perspective], &_featureWeights[featureIndex(perspective, kingSquare, piece) * NNUE_HIDDEN]);
+			}
+		}
+	}
+}
+
+void Network::update(Accumulator& acc, const Accumulator& prev, const Game& before, const Game& after, const Move& move) const {
+	Piece mover = before.getPiece(move.from);
+
+	// every square whose occupant can change: the move itself, an en passant victim and a castling rook
+	Position squares[4] = {move.from, move.to};
+	uint numSquares = 2;
+
+	if (mover.type() == PieceTypes::PAWN && move.to.file != move.from.file && !before.hasPiece(move.to)) {
+		squares[numSquares++] = {.file = move.to.file, .rank = move.from.rank};
+	}
+	if (mover.type() == PieceTypes::KING && abs((int)move.to.file - (int)move.from.file) == 2) {
+		bool kingSide = move.to.file > move.from.file;
+
+		squares[numSquares++] = {.file = kingSide ? Files::H : Files::A, .rank = move.from.rank};
+		squares[numSquares++] = {.file = kingSide ? Files::F : Files::D, .rank = move.from.rank};
+	}
+
+	for (const Players perspective : {Players::WHITE, Players::BLACK}) {
+		// moving our own king changes every feature for this side
+		if (mover.type() == PieceTypes::KING && mover.player() == perspective) {
+			refresh(acc, after, perspective);
+			continue;
+		}
+
+		if (&acc != &prev) {
+			memcpy(acc.values[perspective], prev.values[perspective], sizeof(acc.values[perspective]));
+		}
+
+		uint kingSquare = kingSquareOf(after, perspective);
+
+		for (uint i = 0; i < numSquares; i++) {
+			if (before.hasPiece(squares[i])) {
+				Piece piece = before.getPiece(squares[i]);
+
+				if (piece.type() != PieceTypes::KING) {
+					nnueSubColumn(acc.values[perspective], &_featureWeights[featureIndex(perspective, kingSquare, piece) * NNUE_HIDDEN]);
+				}
+			}
+			if (after.hasPiece(squares[i])) {
+				Piece piece = after.getPiece(squares[i]);
+
+				if (piece.type() != PieceTypes::KING) {
+					nnueAddColumn(acc.values[perspective], &_featureWeights[featureIndex(perspective, kingSquare, piece) * NNUE_HIDDEN]);
+				}
+			}
+		}
+	}
+}
+
+int Network::evaluate(const Accumulator& acc, Players turn) const {
+	Players other = turn == Players::WHITE ? Players::BLACK : Players::WHITE;
+
+	int64_t output = (int64_t)nnueClippedDot(acc.values[turn], _outputWeights.data()) +
+					 nnueClippedDot(acc.values[other], _outputWeights.data() + NNUE_HIDDEN) + _outputBias;
+
+	return (int)(output * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+}
+
+int Network::evaluate(const Game& game) const {
+	Accumulator acc;
+	refresh(acc, game);
+
+	return evaluate(acc, game.turn());
+}
\ No newline at end of file
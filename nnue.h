@@ -0,0 +1,68 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+
+// HalfKP feature set: every non-king piece is a feature relative to the square of each side's king
+const uint NNUE_PIECE_FEATURES = 10 * 64 + 1;
+const uint NNUE_INPUTS = 64 * NNUE_PIECE_FEATURES;
+const uint NNUE_HIDDEN = 256;
+
+// quantization: accumulator clipped to [0, NNUE_QA], output weights scaled by NNUE_QB, result scaled to centipawns by NNUE_SCALE
+const int NNUE_QA = 255;
+const int NNUE_QB = 64;
+const int NNUE_SCALE = 400;
+
+// hidden layer for both perspectives; keep one per ply in the search and copy it forward on make, so unmake is just dropping it
+struct Accumulator {
+	alignas(32) int16_t values[2][NNUE_HIDDEN];
+};
+
+// the kernels under refresh, update and evaluate (acc 32-byte aligned, NNUE_HIDDEN values each), and the plain loops they're
+// vectorized from, which they fall back to without SSE4.1 or AVX2; both are here so they can be checked against each other
+void nnueAddColumn(int16_t* acc, const int16_t* weights);
+void nnueSubColumn(int16_t* acc, const int16_t* weights);
+int32_t nnueClippedDot(const int16_t* acc, const int16_t* weights);  // sum of clamp(acc, 0, NNUE_QA) * weights
+void nnueAddColumnScalar(int16_t* acc, const int16_t* weights);
+void nnueSubColumnScalar(int16_t* acc, const int16_t* weights);
+int32_t nnueClippedDotScalar(const int16_t* acc, const int16_t* weights);
+
+/*
+ * Weights file layout (all little-endian):
+ *   char[4]  magic "CENN"
+ *   uint32   version (1)
+ *   uint32   inputs (NNUE_INPUTS)
+ *   uint32   hidden (NNUE_HIDDEN)
+ *   int16    feature biases[hidden]
+ *   int16    feature weights[inputs][hidden]
+ *   int16    output weights[2 * hidden] (side to move's half first)
+ *   int32    output bias
+ */
+class Network {
+public:
+	// reads a weights file, throws if it's missing, truncated or built for a different architecture
+	Network(const std::string& path);
+
+	void refresh(Accumulator& acc, const Game& game) const;
+	void refresh(Accumulator& acc, const Game& game, Players perspective) const;
+
+	// derives acc from prev (the accumulator for before) after move was played to reach after (including any promotion); only touches
+	// the features that changed
+	void update(Accumulator& acc, const Accumulator& prev, const Game& before, const Game& after, const Move& move) const;
+
+	// centipawns, relative to the side to move
+	int evaluate(const Accumulator& acc, Players turn) const;
+	int evaluate(const Game& game) const;
+
+private:
+	std::vector<int16_t> _featureWeights;
+	std::vector<int16_t> _featureBiases;
+	std::vector<int16_t> _outputWeights;
+	int32_t _outputBias;
+};
+
+#endif
\ No newline at end of file
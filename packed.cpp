@@ -0,0 +1,143 @@
+#include "packed.h"
+
+#include <bit>
+
+using namespace std;
+
+static_assert(endian::native == endian::little, "packed position files are little-endian");
+
+const char PIECE_SYMBOLS[12] = {'P', 'N', 'B', 'R', 'Q', 'K', 'p', 'n', 'b', 'r', 'q', 'k'};
+const size_t PACKED_WRITE_BUFFER = 4096;
+
+PackedPosition packPosition(const Game& game) {
+	PackedPosition packed = {};
+	uint8_t codes[64];
+
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		for (const Piece& piece : game.pieces(player)) {
+			uint square = squareOf(piece.position());
+
+			packed.occupancy |= 1ull << square;
+			codes[square] = player * 6 + piece.type();
+		}
+	}
+
+	uint idx = 0;
+	for (uint64_t remaining = packed.occupancy; remaining; remaining &= remaining - 1, idx++) {
+		packed.pieces[idx / 2] |= codes[countr_zero(remaining)] << (idx % 2 * 4);
+	}
+
+	packed.flags = game.turn() == Players::BLACK ? 1 : 0;
+	packed.flags |= game.canCastle(Players::WHITE, true) << 1;
+	packed.flags |= game.canCastle(Players::WHITE, false) << 2;
+	packed.flags |= game.canCastle(Players::BLACK, true) << 3;
+	packed.flags |= game.canCastle(Players::BLACK, false) << 4;
+
+	Position target;
+	packed.enPassant = game.enPassantTarget(target) ? squareOf(target) : PACKED_NO_EN_PASSANT;
+
+	packed.halfmoveClock = min(game.halfTurnsSinceCapture(), 255);
+	packed.fullmove = min(game.turns(), 65535);
+	packed.result = PACKED_NO_RESULT;
+
+	return packed;
+}
+
+void unpackPosition(const PackedPosition& packed, Game& game) {
+	if (popcount(packed.occupancy) > 32) {
+		throw runtime_error("Corrupt packed position: more than 32 pieces.");
+	}
+
+	game._white.clear();
+	game._black.clear();
+
+	uint idx = 0, kings[2] = {0, 0};
+	for (uint64_t remaining = packed.occupancy; remaining; remaining &= remaining - 1, idx++) {
+		uint square = countr_zero(remaining), code = packed.pieces[idx / 2] >> (idx % 2 * 4) & 0xF;
+
+		if (code >= 12) {
+			throw runtime_error("Corrupt packed position: bad piece code.");
+		}
+
+		Piece piece(PIECE_SYMBOLS[code], {.file = (Files)(square % 8), .rank = square / 8 + 1});
+		if (piece._type == PieceTypes::KING) {
+			kings[piece._player]++;
+		}
+		if (piece._type == PieceTypes::ROOK) {
+			// only rooks backing a castling right count as unmoved
+			uint right = piece._position.file == Files::H ? 0 : piece._position.file == Files::A ? 1 : 2;
+			uint backRank = piece._player == Players::WHITE ? 1 : 8;
+
+			piece._moved = !(right < 2 && piece._position.rank == backRank && (packed.flags >> (1 + piece._player * 2 + right) & 1));
+		}
+
+		if (!(piece._player == Players::WHITE ? game._white : game._black).push_back(piece)) {
+			throw runtime_error("Corrupt packed position: more than 16 pieces on one side.");
+		}
+	}
+
+	if (kings[Players::WHITE] != 1 || kings[Players::BLACK] != 1) {
+		throw runtime_error("Corrupt packed position: each side needs exactly one king.");
+	}
+
+	game._turn = packed.flags & 1 ? Players::BLACK : Players::WHITE;
+	game._shouldPromote = false;
+	game._prevMoveEnPassant = false;
+	game._firstMove = packed.enPassant == PACKED_NO_EN_PASSANT;
+	if (!game._firstMove) {
+		// rebuild the double push that Game reads the en passant square from
+		Files file = (Files)(packed.enPassant % 8);
+		bool whitePushed = packed.enPassant / 8 == 2;
+
+		game._prevMove = {.from = {.file = file, .rank = whitePushed ? 2u : 7u}, .to = {.file = file, .rank = whitePushed ? 4u : 5u}};
+	}
+
+	game._halfTurnsSinceCapture = packed.halfmoveClock;
+	game._turns = packed.fullmove;
+
+	game._resetPieceState();
+	game._resetHistory();
+}
+
+PackedPositionWriter::PackedPositionWriter(const string& path, bool append)
+	: _out(path, ios::binary | (append ? ios::app : ios::trunc)), _path(path), _written(0) {
+	if (!_out) {
+		throw runtime_error("Could not open " + path + " for writing.");
+	}
+
+	_buffer.reserve(PACKED_WRITE_BUFFER);
+}
+
+PackedPositionWriter::~PackedPositionWriter() {
+	try {
+		flush();
+	} catch (...) {
+		// nowhere to report it from a destructor, call flush() first to find out
+	}
+}
+
+void PackedPositionWriter::write(const PackedPosition& position) {
+	_buffer.push_back(position);
+	_written++;
+
+	if (_buffer.size() == PACKED_WRITE_BUFFER) {
+		flush();
+	}
+}
+
+void PackedPositionWriter::flush() {
+	_out.write((const char*)_buffer.data(), _buffer.size() * sizeof(PackedPosition));
+	_out.flush();
+	_buffer.clear();
+
+	if (!_out) {
+		throw runtime_error("Failed writing positions to " + _path + ".");
+	}
+}
+
+PackedPositionReader::PackedPositionReader(const string& path)
+	: _file(path), _records((const PackedPosition*)_file.data()), _size(_file.size() / sizeof(PackedPosition)) {
+	if (_file.size() % sizeof(PackedPosition) != 0) {
+		throw runtime_error(path + " is not a whole number of packed positions.");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+#include "mapped_file.h"
+
+/*
+ * 32 byte fixed-width position record. Files are just records back to back (no header), written in host byte order, which is
+ * little-endian everywhere this is built; that's what lets PackedPositionReader index straight into the mapped file.
+ */
+struct PackedPosition {
+	uint64_t occupancy;	  // bit n set when square n (squareOf) has a piece
+	uint8_t pieces[16];	  // 4 bit piece codes (player * 6 + type) in occupancy order, low nibble first
+	uint16_t fullmove;
+	int16_t score;		  // dataset annotations, left 0 by packPosition: eval in centipawns for the side to move
+	uint8_t flags;		  // bit 0 black to move, bits 1-4 castling rights K, Q, k, q
+	uint8_t enPassant;	  // square behind a pawn that just double pushed, PACKED_NO_EN_PASSANT if none
+	uint8_t halfmoveClock;	// saturates at 255
+	uint8_t result;		  // dataset annotation: 0 black won, 1 draw, 2 white won, PACKED_NO_RESULT (the default) if unknown
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+const uint8_t PACKED_NO_EN_PASSANT = 0xFF;
+const uint8_t PACKED_NO_RESULT = 0xFF;
+
+PackedPosition packPosition(const Game& game);
+
+// throws if the record doesn't describe a position (bad piece codes or king count); reuses game's piece storage like parseFEN
+void unpackPosition(const PackedPosition& packed, Game& game);
+
+// buffers records and appends them to the file in large writes
+class PackedPositionWriter {
+public:
+	PackedPositionWriter(const std::string& path, bool append = false);
+	~PackedPositionWriter();
+
+	void write(const PackedPosition& position);
+	void flush();
+
+	size_t written() const { return _written; }
+
+private:
+	std::ofstream _out;
+	std::string _path;
+	std::vector<PackedPosition> _buffer;
+	size_t _written;
+};
+
+// maps a whole file of records, so reading is indexing and the OS pages records in as they're touched
+class PackedPositionReader {
+public:
+	PackedPositionReader(const std::string& path);
+
+	size_t size() const { return _size; }
+
+	const PackedPosition& operator[](size_t idx) const { return _records[idx]; }
+
+	const PackedPosition* begin() const { return _records; }
+	const PackedPosition* end() const { return _records + _size; }
+
+private:
+	MappedFile _file;
+	const PackedPosition* _records;
+	size_t _size;
+};
+
+#endif
\ No newline at end of file
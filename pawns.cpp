@@ -0,0 +1,142 @@
+#include "pawns.h"
+
+using namespace std;
+
+const int DOUBLED_MG = -10, DOUBLED_EG = -25;
+const int ISOLATED_MG = -5, ISOLATED_EG = -15;
+const int BACKWARD_MG = -8, BACKWARD_EG = -10;
+const int PASSED_MG[8] = {0, 5, 10, 10, 20, 40, 70, 0};	 // by relative rank
+const int PASSED_EG[8] = {0, 10, 15, 25, 45, 80, 130, 0};
+const int SHELTER_CLOSE = 12, SHELTER_ADVANCED = 6, SHELTER_MISSING = -12;
+
+const uint64_t FILE_A_MASK = 0x0101010101010101ull;
+
+static uint64_t fileMask(int file) {
+	return FILE_A_MASK << file;
+}
+
+static uint64_t adjacentFilesMask(int file) {
+	return (file > 0 ? fileMask(file - 1) : 0) | (file < 7 ? fileMask(file + 1) : 0);
+}
+
+// every square on a rank strictly in front of rank (0-7) from the player's point of view
+static uint64_t forwardRanksMask(Players player, int rank) {
+	if (player == Players::WHITE) {
+		return rank == 7 ? 0 : ~0ull << (8 * (rank + 1));
+	} else {
+		return (1ull << (8 * rank)) - 1;
+	}
+}
+
+static bool hasSquare(uint64_t board, int file, int rank) {
+	return file >= 0 && file < 8 && rank >= 0 && rank < 8 && (board >> (rank * 8 + file) & 1);
+}
+
+static void fillEntry(uint64_t key, const uint64_t pawns[2], PawnEntry& entry) {
+	entry.key = key;
+
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		Players opponent = player == Players::WHITE ? Players::BLACK : Players::WHITE;
+		uint64_t ours = pawns[player], theirs = pawns[opponent];
+		int forward = player == Players::WHITE ? 1 : -1;
+
+		entry.mg[player] = entry.eg[player] = 0;
+		entry.passedFiles[player] = 0;
+
+		for (uint64_t remaining = ours; remaining; remaining &= remaining - 1) {
+			int square = __builtin_ctzll(remaining), file = square % 8, rank = square / 8;
+			int relativeRank = player == Players::WHITE ? rank : 7 - rank;
+			uint64_t ahead = forwardRanksMask(player, rank), adjacent = adjacentFilesMask(file);
+
+			if (!(theirs & ahead & (fileMask(file) | adjacent))) {
+				entry.mg[player] += PASSED_MG[relativeRank];
+				entry.eg[player] += PASSED_EG[relativeRank];
+				entry.passedFiles[player] |= 1 << file;
+			}
+			if (ours & ahead & fileMask(file)) {
+				entry.mg[player] += DOUBLED_MG;
+				entry.eg[player] += DOUBLED_EG;
+			}
+
+			if (!(ours & adjacent)) {
+				entry.mg[player] += ISOLATED_MG;
+				entry.eg[player] += ISOLATED_EG;
+			} else if (!(ours & adjacent & ~ahead) &&
+					   (hasSquare(theirs, file - 1, rank + 2 * forward) || hasSquare(theirs, file + 1, rank + 2 * forward))) {
+				// every neighbour has already advanced past it and an enemy pawn guards the square in front
+				entry.mg[player] += BACKWARD_MG;
+				entry.eg[player] += BACKWARD_EG;
+			}
+		}
+
+		int homeRank = player == Players::WHITE ? 0 : 7;
+		for (int kingFile = 0; kingFile < 8; kingFile++) {
+			entry.shelter[player][kingFile] = 0;
+
+			for (int file = kingFile - 1; file <= kingFile + 1; file++) {
+				if (file < 0 || file > 7) {
+					continue;
+				}
+
+				if (hasSquare(ours, file, homeRank + forward)) {
+					entry.shelter[player][kingFile] += SHELTER_CLOSE;
+				} else if (hasSquare(ours, file, homeRank + 2 * forward)) {
+					entry.shelter[player][kingFile] += SHELTER_ADVANCED;
+				} else {
+					entry.shelter[player][kingFile] += SHELTER_MISSING;
+				}
+			}
+		}
+	}
+}
+
+PawnTable::PawnTable(size_t entries) : _probes(0), _hits(0) {
+	size_t size = 1;
+	while (size * 2 <= entries) {
+		size *= 2;
+	}
+
+	_entries.resize(size);
+	_mask = size - 1;
+	clear();
+}
+
+const PawnEntry& PawnTable::probe(const Game& game) {
+	PawnEntry& entry = _entries[game.pawnKey() & _mask];
+
+	_probes++;
+	if (entry.key == game.pawnKey()) {
+		_hits++;
+	} else {
+		evaluatePawns(game, entry);
+	}
+
+	return entry;
+}
+
+void PawnTable::clear() {
+	// key 0 is the pawnless board, so seeding every slot with its entry keeps empty slots from ever being wrong
+	const uint64_t noPawns[2] = {0, 0};
+	PawnEntry empty;
+	fillEntry(0, noPawns, empty);
+
+	for (PawnEntry& entry : _entries) {
+		entry = empty;
+	}
+
+	_probes = _hits = 0;
+}
+
+void evaluatePawns(const Game& game, PawnEntry& entry) {
+	uint64_t pawns[2] = {0, 0};
+
+	for (const Players player : {Players::WHITE, Players::BLACK}) {
+		for (const Piece& piece : game.pieces(player)) {
+			if (piece.type() == PieceTypes::PAWN) {
+				pawns[player] |= 1ull << squareOf(piece.position());
+			}
+		}
+	}
+
+	fillEntry(game.pawnKey(), pawns, entry);
+}
\ No newline at end of file
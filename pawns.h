@@ -0,0 +1,41 @@
+#ifndef PAWNS_H
+#define PAWNS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "chess.h"
+
+// everything that only depends on where the pawns are, for both players
+struct PawnEntry {
+	uint64_t key;
+	int mg[2];
+	int eg[2];
+	int shelter[2][8];	// middlegame bonus for a king on its back two ranks, by the king's file
+	uint8_t passedFiles[2];	 // bit per file holding a passed pawn
+};
+
+// cache of pawn structure evaluations keyed by Game::pawnKey
+class PawnTable {
+public:
+	// entries is rounded down to a power of two
+	PawnTable(size_t entries = 1 << 14);
+
+	const PawnEntry& probe(const Game& game);
+
+	void clear();
+
+	uint64_t probes() const { return _probes; }
+	uint64_t hits() const { return _hits; }
+
+private:
+	std::vector<PawnEntry> _entries;
+	uint64_t _mask;
+	uint64_t _probes;
+	uint64_t _hits;
+};
+
+// fills an entry from scratch (doubled, isolated, backward and passed pawns, plus the shelter table)
+void evaluatePawns(const Game& game, PawnEntry& entry);
+
+#endif
\ No newline at end of file
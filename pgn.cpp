@@ -0,0 +1,376 @@
+#include "pgn.h"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+Game PGNGame::start() const {
+	auto fen = tags.find("FEN");
+
+	return fen == tags.end() ? Game() : Game(fen->second);
+}
+
+PGNReader::PGNReader(const string& path, size_t bufferSize) : PGNReader(path, 0, UINT64_MAX, bufferSize) {}
+
+PGNReader::PGNReader(const string& path, uint64_t begin, uint64_t end, size_t bufferSize)
+	: _in(path, ios::binary), _buffer(max<size_t>(bufferSize, 1)), _pos(0), _len(0), _bufferOffset(0), _end(end) {
+	if (!_in) {
+		throw runtime_error("Could not open " + path + ".");
+	}
+
+	if (begin > 0) {
+		_seekToGame(begin);
+	}
+}
+
+bool PGNReader::_refill() {
+	_bufferOffset += _len;
+	_pos = _len = 0;
+
+	if (_in) {
+		_in.read(_buffer.data(), _buffer.size());
+		_len = _in.gcount();
+	}
+
+	return _len > 0;
+}
+
+int PGNReader::_peek() {
+	if (_pos == _len && !_refill()) {
+		return -1;
+	}
+
+	return (unsigned char)_buffer[_pos];
+}
+
+int PGNReader::_get() {
+	int c = _peek();
+
+	if (c != -1) {
+		_pos++;
+	}
+
+	return c;
+}
+
+void PGNReader::_seekToGame(uint64_t begin) {
+	// back up a few bytes so a blank line ("\n\n" or "\r\n\r\n") right before begin is still seen
+	uint64_t start = begin >= 4 ? begin - 4 : 0;
+	_in.seekg(start);
+	_bufferOffset = start;
+	_pos = _len = 0;
+
+	int c, newlines = 0;
+	while ((c = _peek()) != -1) {
+		if (c == '[' && newlines >= 2 && offset() >= begin) {
+			return;
+		}
+
+		_get();
+		if (c == '\n') {
+			newlines++;
+		} else if (c != '\r' && c != ' ' && c != '\t') {
+			newlines = 0;
+		}
+	}
+}
+
+static bool isResult(const string& token) {
+	return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool PGNReader::next(PGNGame& game) {
+	game.tags.clear();
+	game.moves.clear();
+	game.result.clear();
+
+	int c;
+	while ((c = _peek()) != -1 && isspace(c)) {
+		_get();
+	}
+	if (c == -1 || offset() >= _end) {
+		return false;
+	}
+
+	int variationDepth = 0;
+	string token;
+
+	// true once the game's result has been read
+	auto finishToken = [&]() {
+		if (variationDepth == 0 && !token.empty()) {
+			if (isResult(token)) {
+				game.result = token;
+				return true;
+			}
+			// move numbers are all digits (the dots split tokens), so castling written with zeros ("0-0") isn't one
+			bool moveNumber = all_of(token.begin(), token.end(), [](char c) { return isdigit(c); });
+			if (token[0] != '$' && token[0] != '!' && token[0] != '?' && !moveNumber) {
+				game.moves.push_back(token);
+			}
+		}
+
+		token.clear();
+		return false;
+	};
+
+	while ((c = _peek()) != -1) {
+		if (c == '[' && variationDepth == 0 && token.empty()) {
+			if (!game.moves.empty()) {
+				break;	// next game's tags, this one never had a result
+			}
+
+			// [Name "value"], with \" and \\ escapes in the value
+			_get();
+			string name, value;
+			while ((c = _get()) != -1 && !isspace(c) && c != ']') {
+				name += c;
+			}
+			while (c != -1 && c != '"' && c != ']' && c != '\n') {
+				c = _get();
+			}
+			if (c == '"') {
+				while ((c = _get()) != -1 && c != '"' && c != '\n') {
+					if (c == '\\' && (_peek() == '"' || _peek() == '\\')) {
+						c = _get();
+					}
+					value += c;
+				}
+			}
+			while (c != -1 && c != ']' && c != '\n') {
+				c = _get();
+			}
+
+			game.tags[name] = value;
+			continue;
+		}
+
+		_get();
+		if (c == '{' || c == ';' || c == '(' || c == ')' || isspace(c) || c == '.') {
+			if (finishToken()) {
+				return true;
+			}
+		}
+
+		if (c == '{') {
+			while ((c = _get()) != -1 && c != '}') {
+			}
+		} else if (c == ';') {
+			while ((c = _get()) != -1 && c != '\n') {
+			}
+		} else if (c == '(') {
+			variationDepth++;
+		} else if (c == ')') {
+			variationDepth = max(0, variationDepth - 1);
+		} else if (!isspace(c) && c != '.' && variationDepth == 0) {
+			token += c;
+		}
+	}
+
+	if (!finishToken() || game.result.empty()) {
+		game.result = "*";
+	}
+
+	return true;
+}
+
+Move decodeSAN(const Game& game, string_view san, PieceTypes& promotion) {
+	string_view original = san;
+	promotion = PieceTypes::PAWN;
+
+	while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+		san.remove_suffix(1);
+	}
+
+	uint backRank = game.turn() == Players::WHITE ? 1 : 8;
+	if (san == "O-O" || san == "0-0") {
+		return {.from = {.file = Files::E, .rank = backRank}, .to = {.file = Files::G, .rank = backRank}};
+	}
+	if (san == "O-O-O" || san == "0-0-0") {
+		return {.from = {.file = Files::E, .rank = backRank}, .to = {.file = Files::C, .rank = backRank}};
+	}
+
+	if (san.size() >= 2 && string_view("NBRQ").find(san.back()) != string_view::npos &&
+		(san[san.size() - 2] == '=' || isdigit(san[san.size() - 2]))) {
+		promotion = Piece(san.back(), {.file = Files::A, .rank = 1}).type();
+		san.remove_suffix(1);
+
+		if (san.back() == '=') {
+			san.remove_suffix(1);
+		}
+	}
+
+	PieceTypes type = PieceTypes::PAWN;
+	if (!san.empty() && string_view("NBRQK").find(san[0]) != string_view::npos) {
+		type = Piece(san[0], {.file = Files::A, .rank = 1}).type();
+		san.remove_prefix(1);
+	}
+
+	if (san.size() < 2 || san[san.size() - 2] < 'a' || san[san.size() - 2] > 'h' || san.back() < '1' || san.back() > '8') {
+		throw runtime_error("Malformed SAN move '" + string(original) + "'.");
+	}
+
+	Position to = {.file = (Files)(san[san.size() - 2] - 'a'), .rank = (uint)(san.back() - '0')};
+	int fromFile = -1, fromRank = -1;
+	bool capture = false;
+
+	for (uint i = 0; i + 2 < san.size(); i++) {
+		if (san[i] >= 'a' && san[i] <= 'h') {
+			fromFile = san[i] - 'a';
+		} else if (san[i] >= '1' && san[i] <= '8') {
+			fromRank = san[i] - '0';
+		} else if (san[i] == 'x') {
+			capture = true;
+		} else {
+			throw runtime_error("Malformed SAN move '" + string(original) + "'.");
+		}
+	}
+
+	Move found;
+	uint matches = 0;
+
+	for (const Piece& piece : game.pieces(game.turn())) {
+		if (piece.type() != type || (fromFile != -1 && (int)piece.position().file != fromFile) ||
+			(fromRank != -1 && (int)piece.position().rank != fromRank)) {
+			continue;
+		}
+		// pawns only change file when capturing, and SAN always says so
+		if (type == PieceTypes::PAWN && (piece.position().file != to.file) != capture) {
+			continue;
+		}
+
+		try {
+			game.branch({.from = piece.position(), .to = to});
+			found = {.from = piece.position(), .to = to};
+			matches++;
+		} catch (...) {
+			continue;
+		}
+	}
+
+	if (matches == 0) {
+		throw runtime_error("Illegal SAN move '" + string(original) + "'.");
+	} else if (matches > 1) {
+		throw runtime_error("Ambiguous SAN move '" + string(original) + "'.");
+	}
+
+	return found;
+}
+
+string encodeSAN(const Game& game, const Move& move, PieceTypes promotion) {
+	Piece piece = game.getPiece(move.from);
+	Game after = game.branch(move);
+	bool promotes = after.shouldPromote();
+	string san;
+
+	if (promotes) {
+		if (promotion == PieceTypes::PAWN) {
+			throw runtime_error("Move " + to_string(move.from) + " to " + to_string(move.to) + " needs a promotion piece.");
+		}
+
+		after.promote(move.to, promotion);
+	}
+
+	if (piece.type() == PieceTypes::KING && abs((int)move.to.file - (int)move.from.file) == 2) {
+		san = move.to.file > move.from.file ? "O-O" : "O-O-O";
+	} else {
+		bool capture = game.hasPiece(move.to) || (piece.type() == PieceTypes::PAWN && move.to.file != move.from.file);
+
+		if (piece.type() != PieceTypes::PAWN) {
+			san += "NBRQK"[piece.type() - 1];
+
+			// name the file if that's enough to tell apart the other pieces that could also go there, then the rank, then both
+			bool ambiguous = false, sharesFile = false, sharesRank = false;
+			for (const Piece& other : game.pieces(game.turn())) {
+				if (other.type() != piece.type() || other.position() == move.from) {
+					continue;
+				}
+
+				try {
+					game.branch({.from = other.position(), .to = move.to});
+				} catch (...) {
+					continue;
+				}
+
+				ambiguous = true;
+				sharesFile |= other.position().file == move.from.file;
+				sharesRank |= other.position().rank == move.from.rank;
+			}
+
+			if (ambiguous && (!sharesFile || sharesRank)) {
+				san += 'a' + move.from.file;
+			}
+			if (ambiguous && sharesFile) {
+				san += '0' + move.from.rank;
+			}
+		} else if (capture) {
+			san += 'a' + move.from.file;
+		}
+
+		if (capture) {
+			san += 'x';
+		}
+		san += 'a' + move.to.file;
+		san += '0' + move.to.rank;
+
+		if (promotes) {
+			san += '=';
+			san += "NBRQK"[promotion - 1];
+		}
+	}
+
+	if (after.isChecked()) {
+		san += after.status() == GameStates::CHECKMATE ? '#' : '+';
+	}
+
+	return san;
+}
+
+size_t ingestPGN(const string& path, uint threads, const function<void(const PGNGame& game, uint thread)>& handle) {
+	if (threads == 0) {
+		threads = 1;
+	}
+
+	uint64_t size = filesystem::file_size(path);
+	vector<thread> workers;
+	vector<size_t> counts(threads, 0);
+	exception_ptr error;
+	mutex errorLock;
+
+	for (uint t = 0; t < threads; t++) {
+		uint64_t begin = size * t / threads, end = size * (t + 1) / threads;
+
+		workers.emplace_back([&, t, begin, end]() {
+			try {
+				PGNReader reader(path, begin, end);
+				PGNGame game;
+
+				while (reader.next(game)) {
+					handle(game, t);
+					counts[t]++;
+				}
+			} catch (...) {
+				lock_guard<mutex> guard(errorLock);
+
+				if (!error) {
+					error = current_exception();
+				}
+			}
+		});
+	}
+
+	size_t total = 0;
+	for (uint t = 0; t < threads; t++) {
+		workers[t].join();
+		total += counts[t];
+	}
+
+	if (error) {
+		rethrow_exception(error);
+	}
+
+	return total;
+}
\ No newline at end of file
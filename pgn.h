@@ -0,0 +1,67 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chess.h"
+
+struct PGNGame {
+	std::map<std::string, std::string> tags;
+	std::vector<std::string> moves;	 // SAN, mainline only
+	std::string result;				 // "1-0", "0-1", "1/2-1/2" or "*" (also "*" when the movetext just stopped)
+
+	// the FEN tag if there is one, otherwise the standard starting position
+	Game start() const;
+};
+
+/*
+ * Reads games one at a time through a fixed size buffer, so memory use doesn't depend on the size of the file. Comments, NAGs,
+ * move numbers and variations are dropped. A reader can be limited to the games that start in a byte range of the file, where a
+ * game starts at a '[' opening a line right after a blank line (export format), which is what ingestPGN splits files on.
+ */
+class PGNReader {
+public:
+	PGNReader(const std::string& path, size_t bufferSize = 1 << 20);
+	PGNReader(const std::string& path, uint64_t begin, uint64_t end, size_t bufferSize = 1 << 20);
+
+	// false once there are no more games (in range)
+	bool next(PGNGame& game);
+
+	// bytes of the file read so far
+	uint64_t offset() const { return _bufferOffset + _pos; }
+
+private:
+	std::ifstream _in;
+	std::vector<char> _buffer;
+	size_t _pos;
+	size_t _len;
+	uint64_t _bufferOffset;	 // file offset of _buffer[0]
+	uint64_t _end;
+
+	// reads the next chunk once everything buffered has been consumed, false at the end of the file
+	bool _refill();
+	int _peek();
+	int _get();
+
+	void _seekToGame(uint64_t begin);
+};
+
+// SAN (with or without check marks/annotations) to a move; promotion is set to PAWN when the move doesn't promote. Throws on
+// malformed, illegal or ambiguous moves.
+Move decodeSAN(const Game& game, std::string_view san, PieceTypes& promotion);
+
+// shortest disambiguation, '+'/'#' suffixes; promotion must name the piece when the move promotes
+std::string encodeSAN(const Game& game, const Move& move, PieceTypes promotion = PieceTypes::PAWN);
+
+// splits the file into a byte range per thread and calls handle(game, thread) on every game from that thread; handle must be safe
+// to call concurrently (thread is there for per-thread accumulators). Rethrows the first exception a handler threw once all
+// threads are done. Returns the number of games read.
+size_t ingestPGN(const std::string& path, uint threads, const std::function<void(const PGNGame& game, uint thread)>& handle);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef POLYGLOT_H
+#define POLYGLOT_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+#include "mapped_file.h"
+
+// one 16 byte record of a polyglot .bin book (stored big-endian, sorted by key)
+struct PolyglotEntry {
+	uint64_t key;
+	uint16_t move;
+	uint16_t weight;
+	uint32_t learn;
+};
+
+struct BookMove {
+	Move move;
+	PieceTypes promotion;  // PAWN when the move doesn't promote
+	uint16_t weight;
+};
+
+uint64_t polyglotKey(const Game& game);
+
+// polyglot writes castling as the king capturing its own rook, these translate to and from Game's king-moves-two-squares form
+uint16_t encodePolyglotMove(const Game& game, const Move& move, PieceTypes promotion);
+BookMove decodePolyglotMove(const Game& game, uint16_t move, uint16_t weight);
+
+// the book is mmapped rather than read in, so opening it is cheap no matter how large it is
+class PolyglotBook {
+public:
+	PolyglotBook(const std::string& path);
+
+	size_t size() const { return _size; }
+
+	// every book move for the position that is legal in it
+	std::vector<BookMove> lookup(const Game& game) const;
+
+	// picks a move with probability proportional to its weight, false if the position isn't in the book
+	bool pick(const Game& game, std::mt19937_64& rng, BookMove& out) const;
+
+private:
+	MappedFile _file;
+	size_t _size;
+
+	PolyglotEntry _entryAt(size_t idx) const;
+};
+
+// sorts the entries and writes them out as a .bin book
+void writePolyglotBook(const std::string& path, std::vector<PolyglotEntry> entries);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+/*
+ * Fixed capacity lock-free queue for many producers and one consumer (a bounded ring of cells with sequence numbers, after
+ * Vyukov). Producers claim a slot with one compare-and-swap on the tail and publish it through that cell's sequence number, so a
+ * slow producer never blocks the others; the consumer only ever touches the head. Neither side waits: tryPush fails when the ring
+ * is full and tryPop when the next cell hasn't been published yet, and the caller decides whether to spin, yield or do other work.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+	// capacity is rounded up to a power of two
+	BoundedQueue(size_t capacity)
+		: _capacity(std::bit_ceil(capacity < 2 ? 2 : capacity)), _mask(_capacity - 1), _cells(new Cell[_capacity]), _head(0), _tail(0) {
+		for (size_t i = 0; i < _capacity; i++) {
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// any thread; false if the queue is full
+	bool tryPush(const T& value) {
+		size_t pos = _tail.load(std::memory_order_relaxed);
+		Cell* cell;
+
+		for (;;) {
+			cell = &_cells[pos & _mask];
+			intptr_t diff = (intptr_t)cell->sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+
+			if (diff == 0) {
+				// free cell for this lap, claim it unless another producer got there first (which reloads pos)
+				if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;  // still holds last lap's value, the consumer hasn't caught up
+			} else {
+				pos = _tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->value = value;
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer thread only; false if there's nothing published to take
+	bool tryPop(T& out) {
+		Cell& cell = _cells[_head & _mask];
+
+		if (cell.sequence.load(std::memory_order_acquire) != _head + 1) {
+			return false;
+		}
+
+		out = cell.value;
+		cell.sequence.store(_head + _capacity, std::memory_order_release);	// free for the producer one lap ahead
+		_head++;
+		return true;
+	}
+
+	size_t capacity() const { return _capacity; }
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	const size_t _capacity;
+	const size_t _mask;
+	std::unique_ptr<Cell[]> _cells;
+
+	// on their own cache lines so producers bumping the tail don't keep invalidating the consumer's head
+	alignas(64) size_t _head;
+	alignas(64) std::atomic<size_t> _tail;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "search.h"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+#include "eval.h"
+#include "stats.h"
+
+using namespace std;
+
+// how often (in nodes) the clock is read
+const uint64_t TIME_CHECK_INTERVAL = 1024;
+
+Searcher::Searcher(size_t ttEntries, const Network* network)
+	: _tt(bit_floor(max<size_t>(ttEntries, 1))), _ttMask(_tt.size() - 1), _network(network), _accumulators(network ? MAX_STATS_PLY : 0),
+	  _stop(nullptr), _nodes(0), _mustFinish(false), _aborted(false), _traceLimit(0), _traceTruncated(false) {
+	clear();
+}
+
+void Searcher::clear() {
+	fill(_tt.begin(), _tt.end(), TTEntry{});
+	_pawns.clear();
+}
+
+int Searcher::_evaluate(const Game& game, int ply) {
+	return _network ? _network->evaluate(_accumulators[ply], game.turn()) : evaluate(game, _pawns);
+}
+
+bool Searcher::_shouldStop() {
+	if (_aborted) {
+		return true;
+	}
+	if (_mustFinish) {
+		return false;
+	}
+
+	if ((_stop && _stop->load(memory_order_relaxed)) || (_limits.nodes && _nodes >= _limits.nodes)) {
+		_aborted = true;
+	} else if (_limits.milliseconds && _nodes % TIME_CHECK_INTERVAL == 0) {
+		_aborted = chrono::steady_clock::now() - _start >= chrono::milliseconds(_limits.milliseconds);
+	}
+
+	return _aborted;
+}
+
+void Searcher::setTrace(size_t maxEntries) {
+	_traceLimit = maxEntries;
+	_trace.clear();
+	_traceTruncated = false;
+}
+
+void Searcher::_countNode(int ply) {
+	_nodes++;
+	_seldepth = max(_seldepth, (uint)ply);
+	_nodesByPly[min((uint)ply, MAX_STATS_PLY - 1)]++;
+}
+
+void Searcher::_traceChild(int ply, const Move& move, int remaining, int alpha, int beta, int score) {
+	if (_trace.size() < _traceLimit) {
+		_trace.push_back({.depth = _depth, .ply = (uint)ply, .move = move, .remaining = remaining, .alpha = alpha, .beta = beta, .score = score});
+	} else if (_traceLimit) {
+		_traceTruncated = true;
+	}
+}
+
+TTEntry* Searcher::_probe(const Game& game) {
+	TTEntry& entry = _tt[game.key() & _ttMask];
+	STAT_ADD(TT_PROBES, 1);
+	_ttProbes++;
+
+	if (entry.key != game.key()) {
+		return nullptr;
+	}
+
+	STAT_ADD(TT_HITS, 1);
+	_ttHits++;
+	return &entry;
+}
+
+void Searcher::_store(const Game& game, int depth, int score, TTBounds bound, const Move* move, int ply) {
+	TTEntry& entry = _tt[game.key() & _ttMask];
+
+	// mates are stored as distance from this node so they stay right when reached through another path
+	if (score > MATE_BOUND) {
+		score += ply;
+	} else if (score < -MATE_BOUND) {
+		score -= ply;
+	}
+
+	// keep the old move when this search didn't find one, it's still the best guess for ordering
+	uint8_t from = entry.key == game.key() ? entry.from : 0, to = entry.key == game.key() ? entry.to : 0;
+	if (move) {
+		from = squareOf(move->from);
+		to = squareOf(move->to);
+	}
+
+	entry = {.key = game.key(), .score = (int16_t)score, .depth = (uint8_t)max(depth, 0), .bound = bound, .from = from, .to = to};
+}
+
+Searcher::ScoredMove* Searcher::_orderMoves(const Game& game, const TTEntry* entry, bool capturesOnly, uint& count) {
+	MoveList* candidates = new (_arena.allocate<MoveList>()) MoveList();
+	game._candidateMoves(*candidates);
+
+	ScoredMove* out = _arena.allocate<ScoredMove>(candidates->size());
+	count = 0;
+
+	for (const Move& move : *candidates) {
+		bool capture = game.hasPiece(move.to);
+		PieceTypes attacker = game.getPiece(move.from).type();
+
+		if (attacker == PieceTypes::PAWN && move.to.file != move.from.file && !capture) {
+			capture = true;	 // en passant
+		}
+		bool promotes = attacker == PieceTypes::PAWN && (move.to.rank == 1 || move.to.rank == 8);
+
+		if (capturesOnly && !capture && !promotes) {
+			continue;
+		}
+
+		int order = 0;
+		if (promotes) {
+			order += 8000;
+		}
+		if (capture) {
+			PieceTypes victim = game.hasPiece(move.to) ? game.getPiece(move.to).type() : PieceTypes::PAWN;
+
+			order += 1000 + 100 * valueOf(victim) - valueOf(attacker);
+		}
+		if (entry && squareOf(move.from) == entry->from && squareOf(move.to) == entry->to && entry->from != entry->to) {
+			order += 100000;
+		}
+
+		// insertion sort, stable so equal moves keep generation order
+		uint i = count++;
+		for (; i > 0 && out[i - 1].order < order; i--) {
+			out[i] = out[i - 1];
+		}
+		out[i] = {.move = move, .order = order};
+	}
+
+	return out;
+}
+
+bool Searcher::_play(const Game& game, const Move& move, Game& child, PieceTypes& promotion, int ply) {
+	try {
+		child = game.branch(move);
+	} catch (...) {
+		return false;
+	}
+
+	promotion = PieceTypes::PAWN;
+	if (child.shouldPromote()) {
+		promotion = PieceTypes::QUEEN;
+		child.promote(move.to, PieceTypes::QUEEN);
+	}
+
+	if (_network) {
+		// quiescence can in principle run past the usual stack
+		if ((size_t)ply + 1 >= _accumulators.size()) {
+			_accumulators.resize(ply + 2);
+		}
+		_network->update(_accumulators[ply + 1], _accumulators[ply], game, child, move);
+	}
+
+	return true;
+}
+
+int Searcher::_quiesce(const Game& game, int alpha, int beta, int ply) {
+	_countNode(ply);
+	if (_shouldStop()) {
+		return 0;
+	}
+
+	int standPat = _evaluate(game, ply);
+	if (standPat >= beta) {
+		return standPat;
+	}
+	alpha = max(alpha, standPat);
+
+	ArenaScope scope(_arena);
+	uint count;
+	ScoredMove* moves = _orderMoves(game, nullptr, true, count);
+	Game* child = new (_arena.allocate<Game>()) Game(game);
+	PieceTypes promotion;
+
+	for (uint i = 0; i < count; i++) {
+		if (!_play(game, moves[i].move, *child, promotion, ply)) {
+			continue;
+		}
+
+		int score = -_quiesce(*child, -beta, -alpha, ply + 1);
+
+		if (_aborted) {
+			return 0;
+		}
+		_traceChild(ply + 1, moves[i].move, 0, alpha, beta, score);
+		if (score >= beta) {
+			return score;
+		}
+		alpha = max(alpha, score);
+	}
+
+	return alpha;
+}
+
+int Searcher::_negamax(const Game& game, int depth, int alpha, int beta, int ply, Line& line) {
+	line.length = 0;
+
+	// any repeat counts as a draw inside the search, there's no point playing it out to the third time
+	if (ply > 0 && (game.repetitions() >= 1 || game.halfTurnsSinceCapture() >= 100)) {
+		return 0;
+	}
+
+	if (depth <= 0) {
+		return _quiesce(game, alpha, beta, ply);
+	}
+
+	_countNode(ply);
+	if (_shouldStop()) {
+		return 0;
+	}
+
+	TTEntry* entry = _probe(game);
+	if (entry && ply > 0 && entry->depth >= depth) {
+		int score = entry->score;
+		if (score > MATE_BOUND) {
+			score -= ply;
+		} else if (score < -MATE_BOUND) {
+			score += ply;
+		}
+
+		if (entry->bound == TTBounds::EXACT || (entry->bound == TTBounds::LOWER && score >= beta) ||
+			(entry->bound == TTBounds::UPPER && score <= alpha)) {
+			return score;
+		}
+	}
+
+	// everything below lives until this node returns
+	ArenaScope scope(_arena);
+	uint count;
+	ScoredMove* moves = _orderMoves(game, entry, false, count);
+	Game* child = new (_arena.allocate<Game>()) Game(game);
+	Line* childLine = _arena.allocate<Line>();
+	PieceTypes promotion;
+
+	int originalAlpha = alpha, best = -INFINITE_SCORE;
+	const Move* bestMove = nullptr;
+	uint played = 0;
+
+	for (uint i = 0; i < count; i++) {
+		if (!_play(game, moves[i].move, *child, promotion, ply)) {
+			continue;
+		}
+		played++;
+
+		int score = -_negamax(*child, depth - 1, -beta, -alpha, ply + 1, *childLine);
+
+		if (_aborted) {
+			return 0;
+		}
+		_traceChild(ply + 1, moves[i].move, depth - 1, alpha, beta, score);
+		if (score > best) {
+			best = score;
+			bestMove = &moves[i].move;
+		}
+		if (score > alpha) {
+			alpha = score;
+
+			line.moves[0] = moves[i].move;
+			line.length = min(childLine->length + 1, MAX_SEARCH_DEPTH);
+			copy(childLine->moves, childLine->moves + line.length - 1, line.moves + 1);
+		}
+		if (alpha >= beta) {
+			STAT_CUTOFF(played - 1);
+			_failHighs++;
+			_failHighsFirst += played == 1;
+			break;
+		}
+	}
+
+	if (!bestMove) {
+		return game.isChecked() ? -MATE + ply : 0;
+	}
+
+	_store(game, depth, best, best >= beta ? TTBounds::LOWER : best > originalAlpha ? TTBounds::EXACT : TTBounds::UPPER, bestMove, ply);
+
+	return best;
+}
+
+SearchResult Searcher::search(const Game& game, const SearchLimits& limits, const atomic<bool>* stop,
+							  const function<void(const SearchResult& progress)>& onDepth) {
+	STAT_TIMER(TIME_SEARCH);
+
+	if (game.shouldPromote()) {
+		throw runtime_error("Select a promotion piece before searching.");
+	}
+
+	_limits = limits;
+	_stop = stop;
+	_start = chrono::steady_clock::now();
+	_nodes = 0;
+	_aborted = false;
+	_arena.reset();
+	if (_network) {
+		_network->refresh(_accumulators[0], game);
+	}
+
+	// the root moves stay at the bottom of the arena for the whole search, with the illegal ones weeded out once
+	uint candidates, count = 0;
+	ScoredMove* moves = _orderMoves(game, _probe(game), false, candidates);
+	Game* child = new (_arena.allocate<Game>()) Game(game);
+	PieceTypes promotion;
+
+	for (uint i = 0; i < candidates; i++) {
+		if (_play(game, moves[i].move, *child, promotion, 0)) {
+			moves[count++] = moves[i];
+		}
+	}
+	if (count == 0) {
+		throw runtime_error("No legal moves to search.");
+	}
+
+	Line* line = _arena.allocate<Line>();
+	Line* childLine = _arena.allocate<Line>();
+
+	_play(game, moves[0].move, *child, promotion, 0);
+	SearchResult result = {.move = moves[0].move, .promotion = promotion, .score = 0, .depth = 0, .nodes = 0, .milliseconds = 0,
+						   .pv = {moves[0].move}, .stats = {}};
+	uint maxDepth = limits.depth ? min(limits.depth, MAX_SEARCH_DEPTH) : MAX_SEARCH_DEPTH;
+
+	uint64_t previousNodes = 0;
+
+	for (uint depth = 1; depth <= maxDepth; depth++) {
+		_mustFinish = depth == 1;
+
+		_depth = depth;
+		_seldepth = 0;
+		_ttProbes = _ttHits = _failHighs = _failHighsFirst = 0;
+		fill(_nodesByPly, _nodesByPly + MAX_STATS_PLY, 0);
+		uint64_t startNodes = _nodes;
+		auto iterationStart = chrono::steady_clock::now();
+
+		int alpha = -INFINITE_SCORE, best = -INFINITE_SCORE;
+		uint bestIdx = 0;
+		PieceTypes bestPromotion = PieceTypes::PAWN;
+		line->length = 0;
+
+		for (uint i = 0; i < count; i++) {
+			_play(game, moves[i].move, *child, promotion, 0);
+			int score = -_negamax(*child, depth - 1, -INFINITE_SCORE, -alpha, 1, *childLine);
+
+			if (_aborted) {
+				break;
+			}
+			_traceChild(1, moves[i].move, depth - 1, alpha, INFINITE_SCORE, score);
+			if (score > best) {
+				best = score;
+				bestIdx = i;
+				bestPromotion = promotion;
+
+				line->moves[0] = moves[i].move;
+				line->length = min(childLine->length + 1, MAX_SEARCH_DEPTH);
+				copy(childLine->moves, childLine->moves + line->length - 1, line->moves + 1);
+			}
+			alpha = max(alpha, score);
+		}
+
+		if (_aborted) {
+			break;
+		}
+
+		result.move = moves[bestIdx].move;
+		result.promotion = bestPromotion;
+		result.score = best;
+		result.depth = depth;
+		result.pv.assign(line->moves, line->moves + line->length);
+
+		uint64_t iterationNodes = _nodes - startNodes;
+		result.stats = {.seldepth = _seldepth,
+						.nodes = iterationNodes,
+						.milliseconds = (uint64_t)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - iterationStart).count(),
+						.branchingFactor = previousNodes ? (double)iterationNodes / previousNodes : 0,
+						.ttProbes = _ttProbes,
+						.ttHits = _ttHits,
+						.failHighs = _failHighs,
+						.failHighsFirst = _failHighsFirst,
+						.nodesByPly = vector<uint64_t>(_nodesByPly, _nodesByPly + min(_seldepth + 1, MAX_STATS_PLY))};
+		previousNodes = iterationNodes;
+		_store(game, depth, best, TTBounds::EXACT, &result.move, 0);
+
+		if (onDepth) {
+			result.nodes = _nodes;
+			result.milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - _start).count();
+			onDepth(result);
+		}
+
+		// search the best move first next time around, keeping the rest in their previous order
+		rotate(moves, moves + bestIdx, moves + bestIdx + 1);
+
+		if (abs(best) > MATE_BOUND) {
+			break;	// a forced mate either way won't change with more depth
+		}
+
+		// the next iteration takes several times longer than this one, so don't start what can't finish
+		uint64_t elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - _start).count();
+		if (limits.milliseconds && elapsed * 2 >= limits.milliseconds) {
+			break;
+		}
+	}
+
+	result.nodes = _nodes;
+	result.milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - _start).count();
+
+	return result;
+}
+
+static string moveJSON(const Move& move) {
+	string out = to_string(move.from) + to_string(move.to);
+	transform(out.begin(), out.end(), out.begin(), ::tolower);
+
+	return "\"" + out + "\"";
+}
+
+string toJSON(const SearchResult& result) {
+	const SearchStats& stats = result.stats;
+	string out = "{\"depth\":" + to_string(result.depth) + ",\"seldepth\":" + to_string(stats.seldepth) + ",\"score\":" + to_string(result.score);
+
+	out += ",\"nodes\":" + to_string(result.nodes) + ",\"iteration_nodes\":" + to_string(stats.nodes);
+	out += ",\"time_ms\":" + to_string(result.milliseconds) + ",\"iteration_ms\":" + to_string(stats.milliseconds);
+	out += ",\"nps\":" + to_string(result.nodes * 1000 / max<uint64_t>(result.milliseconds, 1));
+	out += ",\"ebf\":" + to_string(stats.branchingFactor);
+	out += ",\"tt_hit_rate\":" + to_string(stats.ttProbes ? (double)stats.ttHits / stats.ttProbes : 0);
+	out += ",\"fail_high_first\":" + to_string(stats.failHighs ? (double)stats.failHighsFirst / stats.failHighs : 0);
+
+	out += ",\"nodes_by_ply\":[";
+	for (size_t i = 0; i < stats.nodesByPly.size(); i++) {
+		out += (i ? "," : "") + to_string(stats.nodesByPly[i]);
+	}
+
+	out += "],\"pv\":[";
+	for (size_t i = 0; i < result.pv.size(); i++) {
+		out += (i ? "," : "") + moveJSON(result.pv[i]);
+	}
+
+	return out + "]}";
+}
+
+string toJSON(const TraceEntry& entry) {
+	return "{\"depth\":" + to_string(entry.depth) + ",\"ply\":" + to_string(entry.ply) + ",\"move\":" + moveJSON(entry.move) +
+		   ",\"remaining\":" + to_string(entry.remaining) + ",\"alpha\":" + to_string(entry.alpha) + ",\"beta\":" + to_string(entry.beta) +
+		   ",\"score\":" + to_string(entry.score) + "}";
+}
\ No newline at end of file
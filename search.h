@@ -0,0 +1,168 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "chess.h"
+#include "nnue.h"
+#include "pawns.h"
+
+// scores at or beyond MATE_BOUND (in absolute value) are mates, MATE - plies to mate
+const int MATE = 32000;
+const int MATE_BOUND = MATE - 256;
+const int INFINITE_SCORE = MATE + 1;
+
+const uint MAX_SEARCH_DEPTH = 64;
+
+// any limit left at 0 is off; the search always finishes depth 1 so there's a move to play
+struct SearchLimits {
+	uint depth = 0;
+	uint64_t nodes = 0;
+	uint64_t milliseconds = 0;
+};
+
+// plies deeper than this (only quiescence gets there) share the last nodesByPly slot
+const uint MAX_STATS_PLY = 128;
+
+// about the last finished iteration
+struct SearchStats {
+	uint seldepth;	// deepest ply reached, quiescence included
+	uint64_t nodes;
+	uint64_t milliseconds;
+	double branchingFactor;	 // nodes over the previous iteration's, 0 at depth 1
+	uint64_t ttProbes;
+	uint64_t ttHits;
+	uint64_t failHighs;		  // beta cutoffs in the main search
+	uint64_t failHighsFirst;  // of those, by the first legal move tried
+	std::vector<uint64_t> nodesByPly;  // up to seldepth
+};
+
+// one searched child, recorded once its score is known (so children come before their parents)
+struct TraceEntry {
+	uint depth;	 // iteration
+	uint ply;	 // of the child, 1 for root moves
+	Move move;	 // into the child
+	int remaining;	// depth left at the child, 0 or less for quiescence
+	int alpha;	// window the child was searched with, from the parent's side
+	int beta;
+	int score;
+};
+
+struct SearchResult {
+	Move move;
+	PieceTypes promotion;  // PAWN unless move promotes
+	int score;			   // centipawns for the side to move
+	uint depth;			   // last depth that finished
+	uint64_t nodes;
+	uint64_t milliseconds;
+	std::vector<Move> pv;  // principal variation of the last finished depth, starting with move
+	SearchStats stats;
+};
+
+// one JSON object (no newline) with the depth, score, PV and stats, for a JSON lines log of every iteration
+std::string toJSON(const SearchResult& result);
+std::string toJSON(const TraceEntry& entry);
+
+enum TTBounds : uint8_t { EXACT, LOWER, UPPER };
+
+struct TTEntry {
+	uint64_t key;
+	int16_t score;
+	uint8_t depth;
+	TTBounds bound;
+	uint8_t from;  // squareOf, both 0 when there's no move
+	uint8_t to;
+};
+
+/*
+ * Iterative deepening negamax alpha-beta with a transposition table and a captures-only quiescence search. Evaluates with the
+ * tapered PST + pawn structure evaluation, or with a network when one is given (its accumulators updated move by move). A
+ * Searcher keeps its tables between searches, so use one per thread.
+ */
+class Searcher {
+public:
+	// ttEntries is rounded down to a power of two
+	Searcher(size_t ttEntries = 1 << 16, const Network* network = nullptr);
+
+	// throws if the game is over (no legal moves) or waiting on a promotion; stop is polled between nodes, and onDepth gets the
+	// result so far after every finished depth (on the searching thread)
+	SearchResult search(const Game& game, const SearchLimits& limits, const std::atomic<bool>* stop = nullptr,
+						const std::function<void(const SearchResult& progress)>& onDepth = nullptr);
+
+	// forget everything learned, for starting a new game
+	void clear();
+
+	// high water mark of the per-search scratch memory
+	size_t arenaCapacity() const { return _arena.capacity(); }
+
+	// record up to maxEntries searched nodes of the following searches into trace(), 0 to stop; meant for small depths
+	void setTrace(size_t maxEntries);
+	const std::vector<TraceEntry>& trace() const { return _trace; }
+	bool traceTruncated() const { return _traceTruncated; }
+
+private:
+	std::vector<TTEntry> _tt;
+	uint64_t _ttMask;
+	PawnTable _pawns;
+	const Network* _network;
+	std::vector<Accumulator> _accumulators;	 // by ply, the root's refreshed at the start of every search
+
+	SearchLimits _limits;
+	const std::atomic<bool>* _stop;
+	std::chrono::steady_clock::time_point _start;
+	uint64_t _nodes;
+	bool _mustFinish;  // depth 1 ignores every limit
+	bool _aborted;
+
+	// statistics of the iteration in progress
+	uint _depth;
+	uint _seldepth;
+	uint64_t _ttProbes;
+	uint64_t _ttHits;
+	uint64_t _failHighs;
+	uint64_t _failHighsFirst;
+	uint64_t _nodesByPly[MAX_STATS_PLY];
+
+	size_t _traceLimit;
+	std::vector<TraceEntry> _trace;
+	bool _traceTruncated;
+
+	// move lists, child positions and PV lines, reset at the start of every search and rewound as each node returns
+	Arena _arena;
+
+	struct ScoredMove {
+		Move move;
+		int order;
+	};
+
+	struct Line {
+		uint length;
+		Move moves[MAX_SEARCH_DEPTH];
+	};
+
+	int _evaluate(const Game& game, int ply);
+	bool _shouldStop();
+
+	int _negamax(const Game& game, int depth, int alpha, int beta, int ply, Line& line);
+	int _quiesce(const Game& game, int alpha, int beta, int ply);
+
+	// candidate moves in the arena, TT move first, then promotions, then captures by MVV-LVA (some may turn out illegal)
+	ScoredMove* _orderMoves(const Game& game, const TTEntry* entry, bool capturesOnly, uint& count);
+
+	// the position after move, promoting to a queen, and with a network the accumulator for ply + 1; false if the move is illegal
+	bool _play(const Game& game, const Move& move, Game& child, PieceTypes& promotion, int ply);
+
+	void _countNode(int ply);
+	void _traceChild(int ply, const Move& move, int remaining, int alpha, int beta, int score);
+
+	TTEntry* _probe(const Game& game);
+	void _store(const Game& game, int depth, int score, TTBounds bound, const Move* move, int ply);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "sprt.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+static double scoreToElo(double score) {
+	if (score <= 0) {
+		return -numeric_limits<double>::infinity();
+	} else if (score >= 1) {
+		return numeric_limits<double>::infinity();
+	}
+
+	return -400 * log10(1 / score - 1);
+}
+
+static double eloToScore(double elo) {
+	return 1 / (1 + pow(10, -elo / 400));
+}
+
+// mean and variance of a single game's score (1, 0.5 or 0)
+static void scoreStats(uint64_t wins, uint64_t draws, uint64_t losses, double& mean, double& variance) {
+	double games = wins + draws + losses;
+	mean = (wins + draws * 0.5) / games;
+	variance = (wins * pow(1 - mean, 2) + draws * pow(0.5 - mean, 2) + losses * pow(mean, 2)) / games;
+}
+
+EloEstimate estimateElo(uint64_t wins, uint64_t draws, uint64_t losses) {
+	uint64_t games = wins + draws + losses;
+	if (games == 0) {
+		return {.elo = 0, .margin = numeric_limits<double>::infinity()};
+	}
+
+	double mean, variance;
+	scoreStats(wins, draws, losses, mean, variance);
+
+	if (mean <= 0 || mean >= 1) {
+		return {.elo = scoreToElo(mean), .margin = numeric_limits<double>::infinity()};
+	}
+
+	double deviation = 1.959964 * sqrt(variance / games);
+
+	return {.elo = scoreToElo(mean), .margin = (scoreToElo(mean + deviation) - scoreToElo(mean - deviation)) / 2};
+}
+
+SPRT::SPRT(double elo0, double elo1, double alpha, double beta)
+	: _score0(eloToScore(elo0)), _score1(eloToScore(elo1)), _lower(log(beta / (1 - alpha))), _upper(log((1 - beta) / alpha)) {}
+
+double SPRT::llr(uint64_t wins, uint64_t draws, uint64_t losses) const {
+	uint64_t games = wins + draws + losses;
+	if (games == 0) {
+		return 0;
+	}
+
+	double mean, variance;
+	scoreStats(wins, draws, losses, mean, variance);
+	if (variance <= 0) {
+		return 0;
+	}
+
+	return games * (_score1 - _score0) * (2 * mean - _score0 - _score1) / (2 * variance);
+}
+
+SPRTResults SPRT::test(uint64_t wins, uint64_t draws, uint64_t losses) const {
+	double ratio = llr(wins, draws, losses);
+
+	if (ratio >= _upper) {
+		return SPRTResults::ACCEPT_H1;
+	} else if (ratio <= _lower) {
+		return SPRTResults::ACCEPT_H0;
+	}
+
+	return SPRTResults::UNDECIDED;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef SPRT_H
+#define SPRT_H
+
+#include <cstdint>
+
+struct EloEstimate {
+	double elo;
+	double margin;	// half width of the 95% confidence interval
+};
+
+// logistic Elo difference of the first player from a score of wins/draws/losses; infinite when every game went one way
+EloEstimate estimateElo(uint64_t wins, uint64_t draws, uint64_t losses);
+
+enum SPRTResults { UNDECIDED, ACCEPT_H0, ACCEPT_H1 };
+
+/*
+ * Sequential probability ratio test between H0: the Elo difference is elo0 and H1: it's elo1, using the normal approximation of
+ * the game score (GSPRT). alpha and beta are the false positive and false negative rates; the test can be checked after every
+ * game and stopped as soon as it decides.
+ */
+class SPRT {
+public:
+	SPRT(double elo0, double elo1, double alpha = 0.05, double beta = 0.05);
+
+	// log likelihood ratio of H1 over H0, 0 until the games have any variance
+	double llr(uint64_t wins, uint64_t draws, uint64_t losses) const;
+
+	SPRTResults test(uint64_t wins, uint64_t draws, uint64_t losses) const;
+
+	double lowerBound() const { return _lower; }
+	double upperBound() const { return _upper; }
+
+private:
+	double _score0;	 // expected score under each hypothesis
+	double _score1;
+	double _lower;
+	double _upper;
+};
+
+#endif
\ No newline at end of file
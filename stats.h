@@ -0,0 +1,211 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+
+/*
+ * Hot path counters and timers, compiled in only with -DCHESS_STATS. Without it every STAT_ macro expands to nothing (its
+ * arguments aren't even evaluated), so normal builds pay nothing. With it, each thread counts into its own ThreadStats, which
+ * only that thread writes, and collectStats() sums all of them, including threads that already exited. Header only, so there's
+ * nothing to add to the build scripts besides the define.
+ */
+
+enum StatCounters {
+	MOVEGEN_CALLS,		// candidate move generation
+	MOVES_GENERATED,	// candidate (pseudo-legal) moves produced
+	BRANCHES,			// Game copies made to try out a move
+	CHECK_TESTS,
+	VALIDATOR_THROWS,	// moves rejected by throwing from the validators
+	TT_PROBES,
+	TT_HITS,
+	STAT_COUNTERS
+};
+
+enum StatTimers { TIME_GET_AVAILABLE_MOVES, TIME_IS_CHECKED, TIME_SEARCH, STAT_TIMERS };
+
+// beta cutoffs by index of the move that caused them, anything later lands in the last slot
+const uint CUTOFF_SLOTS = 8;
+
+#ifdef CHESS_STATS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+struct StatsTotals {
+	uint64_t counters[STAT_COUNTERS] = {};
+	uint64_t cutoffs[CUTOFF_SLOTS] = {};
+	uint64_t timerCalls[STAT_TIMERS] = {};
+	uint64_t timerNanoseconds[STAT_TIMERS] = {};
+};
+
+class ThreadStats;
+
+// every live thread's counts, plus what exited threads left behind
+inline std::mutex statsMutex;
+inline std::vector<ThreadStats*> liveStats;
+inline StatsTotals retiredStats;
+
+class ThreadStats {
+public:
+	ThreadStats() {
+		reset();
+
+		std::lock_guard<std::mutex> lock(statsMutex);
+		liveStats.push_back(this);
+	}
+	ThreadStats(const ThreadStats& other) = delete;
+	// folds the counts into the totals of exited threads
+	~ThreadStats() {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		addTo(retiredStats);
+		liveStats.erase(std::find(liveStats.begin(), liveStats.end(), this));
+	}
+
+	// the calling thread's
+	static ThreadStats& local() {
+		thread_local ThreadStats stats;
+		return stats;
+	}
+
+	void add(StatCounters counter, uint64_t n) { _bump(_counters[counter], n); }
+	void cutoff(uint idx) { _bump(_cutoffs[std::min(idx, CUTOFF_SLOTS - 1)], 1); }
+	void time(StatTimers timer, uint64_t nanoseconds) {
+		_bump(_timerCalls[timer], 1);
+		_bump(_timerNanoseconds[timer], nanoseconds);
+	}
+
+	void addTo(StatsTotals& totals) const {
+		for (uint i = 0; i < STAT_COUNTERS; i++) {
+			totals.counters[i] += _counters[i].load(std::memory_order_relaxed);
+		}
+		for (uint i = 0; i < CUTOFF_SLOTS; i++) {
+			totals.cutoffs[i] += _cutoffs[i].load(std::memory_order_relaxed);
+		}
+		for (uint i = 0; i < STAT_TIMERS; i++) {
+			totals.timerCalls[i] += _timerCalls[i].load(std::memory_order_relaxed);
+			totals.timerNanoseconds[i] += _timerNanoseconds[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	// only from the owning thread (or while it's idle)
+	void reset() {
+		for (std::atomic<uint64_t>& counter : _counters) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+		for (std::atomic<uint64_t>& counter : _cutoffs) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+		for (uint i = 0; i < STAT_TIMERS; i++) {
+			_timerCalls[i].store(0, std::memory_order_relaxed);
+			_timerNanoseconds[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	ThreadStats& operator=(const ThreadStats& other) = delete;
+
+private:
+	// relaxed atomics so reading another thread's counts isn't a race, but only the owner writes so a plain load and store will do
+	std::atomic<uint64_t> _counters[STAT_COUNTERS];
+	std::atomic<uint64_t> _cutoffs[CUTOFF_SLOTS];
+	std::atomic<uint64_t> _timerCalls[STAT_TIMERS];
+	std::atomic<uint64_t> _timerNanoseconds[STAT_TIMERS];
+
+	static void _bump(std::atomic<uint64_t>& counter, uint64_t n) {
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+};
+
+// every thread's counts so far, merged
+inline StatsTotals collectStats() {
+	std::lock_guard<std::mutex> lock(statsMutex);
+
+	StatsTotals totals = retiredStats;
+	for (const ThreadStats* stats : liveStats) {
+		stats->addTo(totals);
+	}
+
+	return totals;
+}
+
+// call while no other thread is counting
+inline void resetStats() {
+	std::lock_guard<std::mutex> lock(statsMutex);
+
+	retiredStats = {};
+	for (ThreadStats* stats : liveStats) {
+		stats->reset();
+	}
+}
+
+inline void printStats(std::ostream& out) {
+	const char* counterNames[STAT_COUNTERS] = {"movegen calls", "moves generated", "branches", "check tests", "validator throws", "TT probes",
+											   "TT hits"};
+	const char* timerNames[STAT_TIMERS] = {"getAvailableMoves", "isChecked", "search"};
+
+	StatsTotals totals = collectStats();
+
+	for (uint i = 0; i < STAT_COUNTERS; i++) {
+		out << counterNames[i] << ": " << totals.counters[i] << std::endl;
+	}
+	if (totals.counters[MOVEGEN_CALLS]) {
+		out << "moves per movegen call: " << (double)totals.counters[MOVES_GENERATED] / totals.counters[MOVEGEN_CALLS] << std::endl;
+	}
+	if (totals.counters[TT_PROBES]) {
+		out << "TT hit rate: " << 100.0 * totals.counters[TT_HITS] / totals.counters[TT_PROBES] << "%" << std::endl;
+	}
+
+	uint64_t cutoffs = 0;
+	for (uint64_t count : totals.cutoffs) {
+		cutoffs += count;
+	}
+	out << "cutoffs: " << cutoffs << std::endl;
+	for (uint i = 0; i < CUTOFF_SLOTS && cutoffs; i++) {
+		out << "  move " << (i + 1) << (i + 1 == CUTOFF_SLOTS ? "+" : "") << ": " << totals.cutoffs[i] << " ("
+			<< 100.0 * totals.cutoffs[i] / cutoffs << "%)" << std::endl;
+	}
+
+	for (uint i = 0; i < STAT_TIMERS; i++) {
+		out << timerNames[i] << ": " << totals.timerCalls[i] << " calls, " << totals.timerNanoseconds[i] / 1000000 << " ms";
+		if (totals.timerCalls[i]) {
+			out << ", " << totals.timerNanoseconds[i] / totals.timerCalls[i] << " ns/call";
+		}
+		out << std::endl;
+	}
+}
+
+class ScopedStatTimer {
+public:
+	ScopedStatTimer(StatTimers timer) : _timer(timer), _start(std::chrono::steady_clock::now()) {}
+	ScopedStatTimer(const ScopedStatTimer& other) = delete;
+	~ScopedStatTimer() {
+		ThreadStats::local().time(_timer, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count());
+	}
+
+	ScopedStatTimer& operator=(const ScopedStatTimer& other) = delete;
+
+private:
+	StatTimers _timer;
+	std::chrono::steady_clock::time_point _start;
+};
+
+#define STAT_CONCAT_(a, b) a##b
+#define STAT_CONCAT(a, b) STAT_CONCAT_(a, b)
+
+#define STAT_ADD(counter, n) ThreadStats::local().add(StatCounters::counter, n)
+#define STAT_CUTOFF(idx) ThreadStats::local().cutoff(idx)
+// times the rest of the enclosing scope
+#define STAT_TIMER(timer) ScopedStatTimer STAT_CONCAT(statTimer, __LINE__)(StatTimers::timer)
+
+#else
+
+#define STAT_ADD(counter, n) ((void)0)
+#define STAT_CUTOFF(idx) ((void)0)
+#define STAT_TIMER(timer) ((void)0)
+
+#endif
+
+#endif
\ No newline at end of file
@@ -1,8 +1,26 @@
 #define CATCH_CONFIG_MAIN
 
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <lib/catch.hpp>
+#include <thread>
 
+#include "arena.h"
+#include "batch.h"
+#include "bitbase.h"
 #include "chess.h"
+#include "eval.h"
+#include "fen.h"
+#include "mcts.h"
+#include "nnue.h"
+#include "packed.h"
+#include "pgn.h"
+#include "polyglot.h"
+#include "queue.h"
+#include "search.h"
+#include "sprt.h"
 
 using namespace std;
 
@@ -169,6 +187,34 @@ TEST_CASE("Game check interactions") {
 							"Illegal move: moving into check/moving while in check.");
 		REQUIRE_NOTHROW(game.move({.from = {.file = Files::C, .rank = 1}, .to = {.file = Files::D, .rank = 2}}));
 	}
+
+	SECTION("Attack maps match a rebuild") {
+		// knight and two pawns on f3, and black reaches nothing past its own third rank
+		REQUIRE(game.attackers(Players::WHITE, {.file = Files::F, .rank = 3}) == 3);
+		REQUIRE(game.attacked(Players::BLACK) == 0x7EFFFF0000000000ull);
+
+		// en passant, a capture that opens lines, castling and a promotion
+		game = Game("r3k2r/1P4pp/8/3pP3/8/8/6PP/R3K2R w KQkq d6 0 1");
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 5}, .to = {.file = Files::D, .rank = 6}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::A, .rank = 8}, .to = {.file = Files::A, .rank = 1}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::E, .rank = 2}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 8}, .to = {.file = Files::G, .rank = 8}}));
+		REQUIRE(game.move({.from = {.file = Files::B, .rank = 7}, .to = {.file = Files::B, .rank = 8}}));
+		REQUIRE_NOTHROW(game.promote({.file = Files::B, .rank = 8}, PieceTypes::QUEEN));
+
+		Game rebuilt(game.dumpFEN());
+		for (const Players player : {Players::WHITE, Players::BLACK}) {
+			REQUIRE(game.attacked(player) == rebuilt.attacked(player));
+
+			for (const Files file : FILES) {
+				for (const uint rank : RANKS) {
+					REQUIRE(game.attackers(player, {.file = file, .rank = rank}) == rebuilt.attackers(player, {.file = file, .rank = rank}));
+				}
+			}
+		}
+		// the new queen hits the rook that just castled
+		REQUIRE(game.attackers(Players::WHITE, {.file = Files::F, .rank = 8}) == 1);
+	}
 }
 
 TEST_CASE("Game castling") {
@@ -205,4 +251,1017 @@ TEST_CASE("Game branching") {
 		REQUIRE_NOTHROW(future = game.branch({.from = {.file = Files::F, .rank = 8}, .to = {.file = Files::B, .rank = 4}}));
 		REQUIRE(future.turn() == Players::WHITE);
 	}
+}
+
+TEST_CASE("Game status") {
+	SECTION("Threefold repetition") {
+		Game game;
+		Move out = {.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}},
+			 back = {.from = {.file = Files::F, .rank = 3}, .to = {.file = Files::G, .rank = 1}},
+			 blackOut = {.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}},
+			 blackBack = {.from = {.file = Files::F, .rank = 6}, .to = {.file = Files::G, .rank = 8}};
+		uint64_t start = game.key();
+
+		for (int i = 0; i < 2; i++) {
+			REQUIRE(game.status() == GameStates::IN_PROGRESS);
+
+			REQUIRE_NOTHROW(game.move(out));
+			REQUIRE_NOTHROW(game.move(blackOut));
+			REQUIRE_NOTHROW(game.move(back));
+			REQUIRE_NOTHROW(game.move(blackBack));
+
+			REQUIRE(game.key() == start);
+			REQUIRE(game.repetitions() == (uint)i + 1);
+		}
+
+		REQUIRE(game.status() == GameStates::REPETITION);
+	}
+
+	SECTION("Castling needs empty, unattacked squares") {
+		Move queenSide = {.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::C, .rank = 1}},
+			 kingSide = {.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::G, .rank = 1}};
+
+		REQUIRE_THROWS(Game("4k3/8/8/8/8/8/8/R2QK2R w KQ - 0 1").branch(queenSide));
+		REQUIRE_THROWS(Game("4k3/8/8/8/8/8/8/RN2K2R w KQ - 0 1").branch(queenSide));
+		REQUIRE_THROWS(Game("3rk3/8/8/8/8/8/8/R3K2R w KQ - 0 1").branch(queenSide));
+		REQUIRE_THROWS(Game("4kr2/8/8/8/8/8/8/R3K2R w KQ - 0 1").branch(kingSide));
+		REQUIRE_NOTHROW(Game("1r2k3/8/8/8/8/8/8/R3K2R w KQ - 0 1").branch(queenSide));
+		REQUIRE_NOTHROW(Game("4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1").branch(kingSide));
+	}
+
+	SECTION("En passant captures are generated") {
+		Game game("4k3/8/8/8/Pp6/8/8/4K3 b - a3 0 1");
+		vector<Move> moves = game.getAvailableMoves();
+
+		REQUIRE(find_if(moves.begin(), moves.end(), [](const Move& move) {
+					return move.from == Position{.file = Files::B, .rank = 4} && move.to == Position{.file = Files::A, .rank = 3};
+				}) != moves.end());
+		REQUIRE(game.branch({.from = {.file = Files::B, .rank = 4}, .to = {.file = Files::A, .rank = 3}}).pieces(Players::WHITE).size() == 1);
+	}
+
+	SECTION("Copies keep every piece of state") {
+		Game game("r3k2r/8/8/8/3p4/8/4P3/R3K2R w KQkq - 3 20");
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}}));
+
+		Game copy;
+		memcpy((void*)&copy, (const void*)&game, sizeof(Game));
+
+		REQUIRE(copy.dumpFEN() == game.dumpFEN());
+		REQUIRE(copy.key() == game.key());
+		REQUIRE(copy.getAvailableMoves().size() == game.getAvailableMoves().size());
+		REQUIRE_NOTHROW(copy.move({.from = {.file = Files::D, .rank = 4}, .to = {.file = Files::E, .rank = 3}}));
+		REQUIRE(copy.pieces(Players::WHITE).size() == 3);
+		REQUIRE(game.pieces(Players::WHITE).size() == 4);
+	}
+
+	SECTION("Keys include castling rights") {
+		Game game;
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::H, .rank = 1}, .to = {.file = Files::G, .rank = 1}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::F, .rank = 6}, .to = {.file = Files::G, .rank = 8}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::H, .rank = 1}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}}));
+
+		// same placement as after 1. Nf3 Nf6, but white can't castle king side anymore
+		REQUIRE(game.key() != Game().branch({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}})
+									 .branch({.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}})
+									 .key());
+		REQUIRE(game.repetitions() == 0);
+	}
+
+	SECTION("Checkmate") {
+		Game game;
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::F, .rank = 2}, .to = {.file = Files::F, .rank = 3}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 7}, .to = {.file = Files::E, .rank = 5}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 2}, .to = {.file = Files::G, .rank = 4}}));
+		REQUIRE(game.status() == GameStates::IN_PROGRESS);
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::D, .rank = 8}, .to = {.file = Files::H, .rank = 4}}));
+
+		REQUIRE(game.status() == GameStates::CHECKMATE);
+	}
+
+	SECTION("Capturing the checking piece is not mate") {
+		Game game("7k/8/8/8/8/8/5PPq/6K1 w - - 0 1 ");
+
+		REQUIRE(game.isChecked());
+		REQUIRE(game.status() == GameStates::IN_PROGRESS);
+	}
+
+	SECTION("Stalemate") {
+		REQUIRE(Game("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1 ").status() == GameStates::STALEMATE);
+	}
+
+	SECTION("Insufficient material") {
+		REQUIRE(Game("8/8/4k3/8/8/3KB3/8/8 w - - 0 1 ").status() == GameStates::INSUFFICIENT_MATERIAL);
+		REQUIRE(Game("8/8/4kb2/8/8/3KB3/8/8 w - - 0 1 ").status() == GameStates::INSUFFICIENT_MATERIAL);
+		REQUIRE(Game("8/8/4k1b1/8/8/3KB3/8/8 w - - 0 1 ").status() == GameStates::IN_PROGRESS);
+		REQUIRE(Game("8/8/4k3/8/8/3KN3/4N3/8 w - - 0 1 ").status() == GameStates::IN_PROGRESS);
+	}
+
+	SECTION("Fifty moves, reset by pawn moves") {
+		Game game("8/4p3/5k2/8/8/3K4/8/R7 w - - 99 80 ");
+
+		REQUIRE(game.status() == GameStates::IN_PROGRESS);
+		REQUIRE(game.branch({.from = {.file = Files::A, .rank = 1}, .to = {.file = Files::A, .rank = 2}}).status() == GameStates::FIFTY_MOVES);
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::A, .rank = 1}, .to = {.file = Files::A, .rank = 2}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 7}, .to = {.file = Files::E, .rank = 5}}));
+		REQUIRE(game.halfTurnsSinceCapture() == 0);
+		REQUIRE(game.status() == GameStates::IN_PROGRESS);
+	}
+}
+
+TEST_CASE("FEN parsing") {
+	Game game;
+
+	SECTION("FEN and EPD") {
+		REQUIRE(!parseFEN("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", game));
+		REQUIRE(game.turn() == Players::BLACK);
+		REQUIRE(game.canCastle(Players::WHITE, true));
+
+		Position target;
+		REQUIRE(game.enPassantTarget(target));
+		REQUIRE(target == Position{.file = Files::E, .rank = 3});
+		REQUIRE(game.key() == Game().branch({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}}).key());
+
+		REQUIRE(!parseFEN("r3k2r/8/8/8/8/8/8/R3K2R w Kq - bm O-O; id \"castles\";", game));
+		REQUIRE(game.canCastle(Players::WHITE, true));
+		REQUIRE(!game.canCastle(Players::WHITE, false));
+		REQUIRE(game.canCastle(Players::BLACK, false));
+		REQUIRE(game.halfTurnsSinceCapture() == 0);
+		REQUIRE(game.turns() == 1);
+
+		REQUIRE(!parseFEN("8/8/4k3/8/8/3K4/8/8 w - - 37 80\n", game));
+		REQUIRE(game.halfTurnsSinceCapture() == 37);
+		REQUIRE(game.turns() == 80);
+	}
+
+	SECTION("Errors") {
+		FENError error = parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", game);
+		REQUIRE(error.code == FENErrors::MISSING_FIELD);
+		REQUIRE(error.offset == 43);
+
+		REQUIRE(parseFEN("rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", game).code == FENErrors::BAD_PLACEMENT);
+		REQUIRE(parseFEN("rnbqkbnr/pppppppp/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", game).code == FENErrors::BAD_PLACEMENT);
+		REQUIRE(parseFEN("rnbqqbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", game).code == FENErrors::BAD_KINGS);
+		REQUIRE(parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", game).code == FENErrors::BAD_SIDE_TO_MOVE);
+		REQUIRE(parseFEN("rnbqkbn1/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", game).code == FENErrors::BAD_CASTLING);
+		REQUIRE(parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e3 0 1", game).code == FENErrors::BAD_EN_PASSANT);
+		REQUIRE(parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0", game).code == FENErrors::MISSING_FIELD);
+		REQUIRE(parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 x", game).code == FENErrors::BAD_CLOCK);
+		REQUIRE(parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 2", game).code == FENErrors::TRAILING_CHARACTERS);
+
+		REQUIRE_THROWS(Game("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR"));
+	}
+}
+
+TEST_CASE("FEN writing") {
+	SECTION("Round trips") {
+		Game game;
+
+		for (const char* fen : {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "r3k2r/8/8/8/8/8/8/R3K2R b Kq - 12 40",
+								"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", "8/8/4k3/8/8/3K4/8/8 w - - 100 1234567890"}) {
+			REQUIRE(!parseFEN(fen, game));
+
+			char buffer[MAX_FEN_LENGTH];
+			REQUIRE(string(buffer, writeFEN(game, buffer)) == fen);
+			REQUIRE(game.dumpFEN() == fen);
+		}
+	}
+
+	SECTION("Moves") {
+		Game game;
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}}));
+		REQUIRE(game.dumpFEN() == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::E, .rank = 2}}));
+
+		char buffer[MAX_FEN_LENGTH];
+		REQUIRE(string(buffer, writeEPD(game, buffer)) == "rnbqkb1r/pppppppp/5n2/8/4P3/8/PPPPKPPP/RNBQ1BNR b kq -");
+	}
+}
+
+TEST_CASE("Packed positions") {
+	const char* fens[] = {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "r3k2r/8/8/8/8/8/8/R3K2R b Kq - 12 40",
+						  "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", "8/8/4k3/8/8/3K4/8/8 w - - 100 300"};
+
+	SECTION("Round trips") {
+		Game game;
+
+		for (const char* fen : fens) {
+			REQUIRE(!parseFEN(fen, game));
+
+			Game unpacked;
+			unpackPosition(packPosition(game), unpacked);
+
+			REQUIRE(unpacked.dumpFEN() == fen);
+			REQUIRE(unpacked.key() == game.key());
+		}
+
+		PackedPosition corrupt = packPosition(game);
+		corrupt.pieces[0] |= 0xF;
+		REQUIRE_THROWS(unpackPosition(corrupt, game));
+	}
+
+	SECTION("Files") {
+		string path = filesystem::temp_directory_path() / "chess-engine-positions.bin";
+
+		{
+			PackedPositionWriter writer(path);
+			Game game;
+
+			for (const char* fen : fens) {
+				REQUIRE(!parseFEN(fen, game));
+				writer.write(packPosition(game));
+			}
+			REQUIRE(writer.written() == 4);
+		}
+
+		PackedPositionReader reader(path);
+		REQUIRE(reader.size() == 4);
+
+		Game game;
+		unpackPosition(reader[2], game);
+		REQUIRE(game.dumpFEN() == fens[2]);
+
+		filesystem::remove(path);
+	}
+}
+
+TEST_CASE("PGN") {
+	SECTION("SAN") {
+		Game game("r3k2r/1P6/8/8/8/2N3N1/8/R3K2R w KQkq - 0 1");
+		PieceTypes promotion;
+
+		REQUIRE(encodeSAN(game, {.from = {.file = Files::C, .rank = 3}, .to = {.file = Files::E, .rank = 4}}) == "Nce4");
+		REQUIRE(encodeSAN(game, {.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::C, .rank = 1}}) == "O-O-O");
+		REQUIRE(encodeSAN(game, {.from = {.file = Files::B, .rank = 7}, .to = {.file = Files::A, .rank = 8}}, PieceTypes::QUEEN) == "bxa8=Q+");
+		REQUIRE(encodeSAN(game, {.from = {.file = Files::A, .rank = 1}, .to = {.file = Files::A, .rank = 8}}) == "Rxa8+");
+		REQUIRE_THROWS(encodeSAN(game, {.from = {.file = Files::B, .rank = 7}, .to = {.file = Files::B, .rank = 8}}));
+
+		Move move = decodeSAN(game, "Nge4", promotion);
+		REQUIRE(move.from == Position{.file = Files::G, .rank = 3});
+		REQUIRE(promotion == PieceTypes::PAWN);
+
+		move = decodeSAN(game, "b8=N", promotion);
+		REQUIRE(move.to == Position{.file = Files::B, .rank = 8});
+		REQUIRE(promotion == PieceTypes::KNIGHT);
+
+		REQUIRE_THROWS_WITH(decodeSAN(game, "Ne4", promotion), "Ambiguous SAN move 'Ne4'.");
+		REQUIRE_THROWS_WITH(decodeSAN(game, "Qd4", promotion), "Illegal SAN move 'Qd4'.");
+		REQUIRE_THROWS_WITH(decodeSAN(game, "Zz9", promotion), "Malformed SAN move 'Zz9'.");
+
+		// a pawn only goes diagonally when the SAN says it captures
+		Game pawns("4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1");
+		REQUIRE_THROWS_WITH(decodeSAN(pawns, "d5", promotion), "Illegal SAN move 'd5'.");
+		REQUIRE(decodeSAN(pawns, "exd5", promotion).from == Position{.file = Files::E, .rank = 4});
+		REQUIRE(decodeSAN(pawns, "e5", promotion).from == Position{.file = Files::E, .rank = 4});
+
+		Game mate("7k/8/6K1/8/8/8/8/R7 w - - 0 1");
+		REQUIRE(encodeSAN(mate, {.from = {.file = Files::A, .rank = 1}, .to = {.file = Files::A, .rank = 8}}) == "Ra8#");
+	}
+
+	string path = filesystem::temp_directory_path() / "chess-engine-games.pgn";
+	{
+		ofstream out(path);
+		out << "[Event \"Quoted \\\"name\\\"\"]\n[Result \"1-0\"]\n\n1. e4 {best by test} e5 (1... c5 2. Nf3) 2. Nf3 $1 Nc6 3. Bb5 1-0\n\n";
+		out << "[Event \"Setup\"]\n[FEN \"8/8/4k3/8/8/3K4/4P3/8 w - - 0 1\"]\n\n1. e4 Kd6 2. Kd4 *\n\n";
+		out << "[Event \"Unfinished\"]\n\n1. d4 d5\n\n";
+		out << "[Event \"Zeros\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Bc4 Bc5 4. 0-0 Nf6 5. d3 0-0 1-0\n\n[Event \"Last\"]\n\n1. c4 1/2-1/2";
+	}
+
+	SECTION("Reading") {
+		PGNReader reader(path, 16);
+		PGNGame pgn;
+
+		REQUIRE(reader.next(pgn));
+		REQUIRE(pgn.tags["Event"] == "Quoted \"name\"");
+		REQUIRE(pgn.moves == vector<string>{"e4", "e5", "Nf3", "Nc6", "Bb5"});
+		REQUIRE(pgn.result == "1-0");
+
+		REQUIRE(reader.next(pgn));
+		REQUIRE(pgn.start().pieces(Players::WHITE).size() == 2);
+		REQUIRE(pgn.moves.size() == 3);
+
+		REQUIRE(reader.next(pgn));
+		REQUIRE(pgn.moves.size() == 2);
+		REQUIRE(pgn.result == "*");
+
+		// castling written with zeros isn't a move number
+		REQUIRE(reader.next(pgn));
+		REQUIRE(pgn.moves.size() == 10);
+		REQUIRE(pgn.moves[6] == "0-0");
+		Game replay = pgn.start();
+		PieceTypes promotion;
+		for (const string& san : pgn.moves) {
+			REQUIRE_NOTHROW(replay.move(decodeSAN(replay, san, promotion)));
+		}
+		REQUIRE(replay.getPiece({.file = Files::G, .rank = 8}).type() == PieceTypes::KING);
+
+		REQUIRE(reader.next(pgn));
+		REQUIRE(pgn.tags["Event"] == "Last");
+		REQUIRE(pgn.result == "1/2-1/2");
+
+		REQUIRE(!reader.next(pgn));
+	}
+
+	SECTION("Parallel ingest") {
+		for (uint threads = 1; threads <= 4; threads++) {
+			atomic<size_t> moves(0);
+
+			REQUIRE(ingestPGN(path, threads, [&](const PGNGame& pgn, uint) { moves += pgn.moves.size(); }) == 5);
+			REQUIRE(moves == 21);
+		}
+	}
+
+	filesystem::remove(path);
+}
+
+TEST_CASE("Game evaluation") {
+	Game game;
+
+	SECTION("Starting position is balanced") {
+		REQUIRE(game.mgScore(Players::WHITE) == game.mgScore(Players::BLACK));
+		REQUIRE(game.egScore(Players::WHITE) == game.egScore(Players::BLACK));
+		REQUIRE(game.phase() == MAX_PHASE);
+		REQUIRE(evaluate(game) == 0);
+	}
+
+	SECTION("Incremental sums match a full rescan") {
+		// Scandinavian, covers captures and castling
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::D, .rank = 7}, .to = {.file = Files::D, .rank = 5}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 4}, .to = {.file = Files::D, .rank = 5}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::D, .rank = 8}, .to = {.file = Files::D, .rank = 5}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::F, .rank = 1}, .to = {.file = Files::E, .rank = 2}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::D, .rank = 5}, .to = {.file = Files::A, .rank = 2}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::G, .rank = 1}}));
+
+		int mg[2] = {0, 0}, eg[2] = {0, 0}, phase = 0;
+		for (const Files file : FILES) {
+			for (const uint rank : RANKS) {
+				Position pos = {.file = file, .rank = rank};
+
+				if (game.hasPiece(pos)) {
+					Piece piece = game.getPiece(pos);
+
+					mg[piece.player()] += mgValue(piece.type(), piece.player(), pos);
+					eg[piece.player()] += egValue(piece.type(), piece.player(), pos);
+					phase += phaseOf(piece.type());
+				}
+			}
+		}
+
+		REQUIRE(game.mgScore(Players::WHITE) == mg[Players::WHITE]);
+		REQUIRE(game.mgScore(Players::BLACK) == mg[Players::BLACK]);
+		REQUIRE(game.egScore(Players::WHITE) == eg[Players::WHITE]);
+		REQUIRE(game.egScore(Players::BLACK) == eg[Players::BLACK]);
+		REQUIRE(game.phase() == phase);
+		REQUIRE(phase == MAX_PHASE);
+	}
+}
+
+TEST_CASE("Pawn structure") {
+	Game game;
+	PawnTable pawns(1 << 10);
+
+	SECTION("Starting structure is symmetric and cached") {
+		const PawnEntry& entry = pawns.probe(game);
+
+		REQUIRE(entry.key == game.pawnKey());
+		REQUIRE(entry.mg[Players::WHITE] == entry.mg[Players::BLACK]);
+		REQUIRE(entry.eg[Players::WHITE] == entry.eg[Players::BLACK]);
+		REQUIRE(entry.passedFiles[Players::WHITE] == 0);
+		REQUIRE(entry.shelter[Players::WHITE][Files::G] == entry.shelter[Players::BLACK][Files::G]);
+
+		REQUIRE(evaluate(game, pawns) == 0);
+		REQUIRE(pawns.probes() == 2);
+		REQUIRE(pawns.hits() == 1);
+	}
+
+	SECTION("Pawn key only tracks pawns") {
+		uint64_t startKey = game.pawnKey();
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}}));
+		REQUIRE(game.pawnKey() == startKey);
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::D, .rank = 7}, .to = {.file = Files::D, .rank = 5}}));
+		REQUIRE(game.pawnKey() != startKey);
+	}
+
+	SECTION("Captures create structural weaknesses") {
+		// 1. e4 d5 2. exd5 doubles white's d-pawns
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::D, .rank = 7}, .to = {.file = Files::D, .rank = 5}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 4}, .to = {.file = Files::D, .rank = 5}}));
+
+		PawnEntry entry;
+		evaluatePawns(game, entry);
+
+		REQUIRE(entry.passedFiles[Players::WHITE] == 0);
+		REQUIRE(entry.eg[Players::WHITE] < entry.eg[Players::BLACK]);
+		REQUIRE(entry.shelter[Players::WHITE][Files::G] == entry.shelter[Players::BLACK][Files::G]);
+	}
+}
+
+// the bytes of a weights file, weight(i) giving the int16s in file order (feature biases, feature weights, output weights)
+template <typename Weights> static string networkBytes(Weights weight, int32_t outputBias) {
+	string bytes = "CENN";
+	auto put32 = [&](uint32_t value) {
+		for (uint i = 0; i < 4; i++) {
+			bytes += (char)(value >> (8 * i));
+		}
+	};
+	put32(1);
+	put32(NNUE_INPUTS);
+	put32(NNUE_HIDDEN);
+
+	size_t count = NNUE_HIDDEN + (size_t)NNUE_INPUTS * NNUE_HIDDEN + 2 * NNUE_HIDDEN;
+	bytes.reserve(bytes.size() + 2 * count + 4);
+	for (size_t i = 0; i < count; i++) {
+		uint16_t value = weight(i);
+		bytes += (char)(value & 0xFF);
+		bytes += (char)(value >> 8);
+	}
+	put32((uint32_t)outputBias);
+
+	return bytes;
+}
+
+static void writeBytes(const string& path, const string& bytes) {
+	ofstream(path, ios::binary).write(bytes.data(), bytes.size());
+}
+
+TEST_CASE("NNUE") {
+	string path = filesystem::temp_directory_path() / "chess-engine-network.bin";
+
+	SECTION("Weights files are read and checked") {
+		// no features, so both perspectives are the biases and the output is (256 * 100 * 1 + 256 * 100 * 2 - 1000) * 400 / (255 * 64)
+		string bytes = networkBytes(
+			[](size_t i) -> int16_t {
+				size_t outputs = NNUE_HIDDEN + (size_t)NNUE_INPUTS * NNUE_HIDDEN;
+				return i < NNUE_HIDDEN ? 100 : i < outputs ? 0 : i < outputs + NNUE_HIDDEN ? 1 : 2;
+			},
+			-1000);
+		writeBytes(path, bytes);
+
+		Network network(path);
+		REQUIRE(network.evaluate(Game()) == 1857);
+		REQUIRE(network.evaluate(Game("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1")) == 1857);
+
+		writeBytes(path, bytes.substr(0, bytes.size() - 2));
+		REQUIRE_THROWS(Network(path));
+
+		writeBytes(path, bytes + '\0');
+		REQUIRE_THROWS(Network(path));
+
+		writeBytes(path, "CENX" + bytes.substr(4));
+		REQUIRE_THROWS(Network(path));
+
+		string version = bytes;
+		version[4] = 2;
+		writeBytes(path, version);
+		REQUIRE_THROWS(Network(path));
+
+		string hidden = bytes;
+		hidden[12] = 0;
+		hidden[13] = 2;
+		writeBytes(path, hidden);
+		REQUIRE_THROWS(Network(path));
+
+		writeBytes(path, "CE");
+		REQUIRE_THROWS(Network(path));
+
+		filesystem::remove(path);
+		REQUIRE_THROWS(Network(path));
+	}
+
+	SECTION("Updates match a refresh") {
+		mt19937 rng(3);
+		uniform_int_distribution<int> small(-32, 32);
+		writeBytes(path, networkBytes([&](size_t) -> int16_t { return small(rng); }, 12345));
+		Network network(path);
+		filesystem::remove(path);
+
+		auto check = [&](const Game& before, const Move& move) {
+			Game after = before.branch(move);
+			if (after.shouldPromote()) {
+				after.promote(move.to, PieceTypes::QUEEN);
+			}
+
+			Accumulator prev, updated, inPlace, fresh;
+			network.refresh(prev, before);
+			network.update(updated, prev, before, after, move);
+			inPlace = prev;
+			network.update(inPlace, inPlace, before, after, move);
+			network.refresh(fresh, after);
+
+			REQUIRE(memcmp(&updated, &fresh, sizeof(Accumulator)) == 0);
+			REQUIRE(memcmp(&inPlace, &fresh, sizeof(Accumulator)) == 0);
+			REQUIRE(network.evaluate(updated, after.turn()) == network.evaluate(after));
+		};
+
+		Game game("r3k2r/1P3ppp/8/3pP3/8/8/5PPP/R3K2R w KQkq d6 0 1");
+		check(game, {.from = {.file = Files::G, .rank = 2}, .to = {.file = Files::G, .rank = 3}});  // quiet
+		check(game, {.from = {.file = Files::A, .rank = 1}, .to = {.file = Files::A, .rank = 8}});  // capture
+		check(game, {.from = {.file = Files::E, .rank = 5}, .to = {.file = Files::D, .rank = 6}});  // en passant
+		check(game, {.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::G, .rank = 1}});  // castling, white's side refreshes
+		check(game, {.from = {.file = Files::B, .rank = 7}, .to = {.file = Files::B, .rank = 8}});  // promotion
+		check(game, {.from = {.file = Files::B, .rank = 7}, .to = {.file = Files::A, .rank = 8}});  // capturing promotion
+
+		game.move({.from = {.file = Files::G, .rank = 2}, .to = {.file = Files::G, .rank = 3}});
+		check(game, {.from = {.file = Files::E, .rank = 8}, .to = {.file = Files::G, .rank = 8}});  // black castling
+		check(game, {.from = {.file = Files::E, .rank = 8}, .to = {.file = Files::D, .rank = 7}});  // black king step
+
+		// and chained along a game, which is how the search uses it
+		Game walk;
+		Accumulator acc;
+		network.refresh(acc, walk);
+		for (uint ply = 0; ply < 200; ply++) {
+			vector<Move> moves = walk.getAvailableMoves();
+			if (moves.empty() || walk.halfTurnsSinceCapture() >= 100) {
+				break;
+			}
+
+			Move move = moves[rng() % moves.size()];
+			Game next = walk.branch(move);
+			if (next.shouldPromote()) {
+				next.promote(move.to, PieceTypes::QUEEN);
+			}
+			network.update(acc, acc, walk, next, move);
+			walk = next;
+
+			Accumulator fresh;
+			network.refresh(fresh, walk);
+			REQUIRE(memcmp(&acc, &fresh, sizeof(Accumulator)) == 0);
+		}
+	}
+
+	SECTION("The search evaluates from its per-ply accumulators") {
+		mt19937 rng(9);
+		uniform_int_distribution<int> small(-32, 32);
+		writeBytes(path, networkBytes([&](size_t) -> int16_t { return small(rng); }, 0));
+		Network network(path);
+		filesystem::remove(path);
+
+		// nothing can be captured after the first move, so depth 1 is the best of the children's evaluations as refreshed
+		Game game;
+		int best = -INFINITE_SCORE;
+		for (const Move& move : game.getAvailableMoves()) {
+			best = max(best, -network.evaluate(game.branch(move)));
+		}
+
+		Searcher searcher(1 << 12, &network);
+		REQUIRE(searcher.search(game, {.depth = 1}).score == best);
+		// and deeper, through quiescence; random weights don't value material, so a sharper position's quiescence takes forever
+		REQUIRE(searcher.search(Game("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3"), {.depth = 3}).depth == 3);
+	}
+
+	SECTION("Vectorized kernels match the plain loops") {
+		mt19937 rng(5);
+		uniform_int_distribution<int> values(-600, 600), weights(-128, 127);
+
+		for (uint round = 0; round < 100; round++) {
+			Accumulator acc;
+			int16_t column[NNUE_HIDDEN];
+			for (uint i = 0; i < NNUE_HIDDEN; i++) {
+				acc.values[0][i] = acc.values[1][i] = values(rng);
+				column[i] = weights(rng);
+			}
+
+			REQUIRE(nnueClippedDot(acc.values[0], column) == nnueClippedDotScalar(acc.values[0], column));
+
+			nnueAddColumn(acc.values[0], column);
+			nnueAddColumnScalar(acc.values[1], column);
+			REQUIRE(memcmp(acc.values[0], acc.values[1], sizeof(acc.values[0])) == 0);
+
+			nnueSubColumn(acc.values[0], column);
+			nnueSubColumnScalar(acc.values[1], column);
+			nnueSubColumn(acc.values[0], column);
+			nnueSubColumnScalar(acc.values[1], column);
+			REQUIRE(memcmp(acc.values[0], acc.values[1], sizeof(acc.values[0])) == 0);
+		}
+	}
+}
+
+TEST_CASE("Polyglot books") {
+	SECTION("Keys match the reference table") {
+		Game game;
+		REQUIRE(polyglotKey(game) == 0x463B96181691FC9Cull);
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}}));
+		REQUIRE(polyglotKey(game) == 0x823C9B50FD114196ull);
+	}
+
+	SECTION("Written books are sorted, searched and picked from by weight") {
+		string path = filesystem::temp_directory_path() / "chess-engine-book.bin";
+		Game start, afterE4 = start.branch({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}});
+		Move e4 = {.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}};
+		Move d4 = {.from = {.file = Files::D, .rank = 2}, .to = {.file = Files::D, .rank = 4}};
+		Move e5 = {.from = {.file = Files::E, .rank = 7}, .to = {.file = Files::E, .rank = 5}};
+		Move illegal = {.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 5}};
+
+		// unsorted, with filler on both sides of the real keys so the search has somewhere to go
+		vector<PolyglotEntry> entries;
+		for (uint64_t i = 64; i-- > 0;) {
+			entries.push_back({.key = i * 0x0400000000000001ull, .move = 0, .weight = 1, .learn = 0});
+		}
+		entries.push_back({.key = polyglotKey(afterE4), .move = encodePolyglotMove(afterE4, e5, PieceTypes::PAWN), .weight = 5, .learn = 0});
+		entries.push_back({.key = polyglotKey(start), .move = encodePolyglotMove(start, d4, PieceTypes::PAWN), .weight = 1, .learn = 0});
+		entries.push_back({.key = polyglotKey(start), .move = encodePolyglotMove(start, illegal, PieceTypes::PAWN), .weight = 100, .learn = 0});
+		entries.push_back({.key = polyglotKey(start), .move = encodePolyglotMove(start, e4, PieceTypes::PAWN), .weight = 3, .learn = 0});
+		writePolyglotBook(path, entries);
+
+		{
+			ifstream in(path, ios::binary);
+			uint64_t previous = 0;
+			unsigned char bytes[16];
+
+			while (in.read((char*)bytes, 16)) {
+				uint64_t key = 0;
+				for (uint i = 0; i < 8; i++) {
+					key = key << 8 | bytes[i];
+				}
+
+				REQUIRE(key >= previous);
+				previous = key;
+			}
+		}
+
+		PolyglotBook book(path);
+		REQUIRE(book.size() == entries.size());
+
+		// heaviest first, and the move that makes no sense in the position is dropped
+		vector<BookMove> moves = book.lookup(start);
+		REQUIRE(moves.size() == 2);
+		REQUIRE(moves[0].move.to == e4.to);
+		REQUIRE(moves[0].weight == 3);
+		REQUIRE(moves[1].move.to == d4.to);
+
+		REQUIRE(book.lookup(afterE4).size() == 1);
+		REQUIRE(book.lookup(afterE4)[0].move.to == e5.to);
+
+		mt19937_64 rng(7);
+		BookMove picked;
+		REQUIRE(!book.pick(start.branch(d4), rng, picked));
+
+		uint e4Picks = 0;
+		for (uint i = 0; i < 4000; i++) {
+			REQUIRE(book.pick(start, rng, picked));
+			e4Picks += picked.move.to == e4.to;
+		}
+		REQUIRE(e4Picks > 2800);  // 3 in 4 expected
+		REQUIRE(e4Picks < 3200);
+
+		filesystem::remove(path);
+	}
+
+	SECTION("Transpositions share a key") {
+		Game a, b;
+
+		REQUIRE_NOTHROW(a.move({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}}));
+		REQUIRE_NOTHROW(a.move({.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}}));
+		REQUIRE_NOTHROW(a.move({.from = {.file = Files::B, .rank = 1}, .to = {.file = Files::C, .rank = 3}}));
+
+		REQUIRE_NOTHROW(b.move({.from = {.file = Files::B, .rank = 1}, .to = {.file = Files::C, .rank = 3}}));
+		REQUIRE_NOTHROW(b.move({.from = {.file = Files::G, .rank = 8}, .to = {.file = Files::F, .rank = 6}}));
+		REQUIRE(polyglotKey(a) != polyglotKey(b));
+		REQUIRE_NOTHROW(b.move({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}}));
+
+		REQUIRE(polyglotKey(a) == polyglotKey(b));
+	}
+
+	SECTION("Castling is encoded as king takes rook") {
+		Game game;
+
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 2}, .to = {.file = Files::E, .rank = 4}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::E, .rank = 7}, .to = {.file = Files::E, .rank = 5}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::G, .rank = 1}, .to = {.file = Files::F, .rank = 3}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::B, .rank = 8}, .to = {.file = Files::C, .rank = 6}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::F, .rank = 1}, .to = {.file = Files::B, .rank = 5}}));
+		REQUIRE_NOTHROW(game.move({.from = {.file = Files::F, .rank = 8}, .to = {.file = Files::B, .rank = 4}}));
+
+		Move castle = {.from = {.file = Files::E, .rank = 1}, .to = {.file = Files::G, .rank = 1}};
+		uint16_t encoded = encodePolyglotMove(game, castle, PieceTypes::PAWN);
+
+		REQUIRE((encoded & 7) == Files::H);
+		REQUIRE(decodePolyglotMove(game, encoded, 1).move.to == castle.to);
+	}
+}
+
+TEST_CASE("Endgame bitbases") {
+	string directory = filesystem::temp_directory_path() / "chess-engine-bitbases";
+	filesystem::create_directories(directory);
+
+	vector<uint8_t> queen = generateBitbase(Endgames::KQK, 1), rook = generateBitbase(Endgames::KRK, 1);
+	writeBitbase(directory + "/KQK.bb", Endgames::KQK, queen);
+	writeBitbase(directory + "/KRK.bb", Endgames::KRK, rook);
+	writeBitbase(directory + "/KPK.bb", Endgames::KPK, generateBitbase(Endgames::KPK, 2, &queen, &rook));
+
+	Bitbases bitbases(directory);
+
+	REQUIRE(bitbases.has(Endgames::KPK));
+	REQUIRE(!bitbases.has(Endgames::KBNK));
+
+	SECTION("Mating material wins unless it hangs") {
+		REQUIRE(bitbases.probe(Game("8/8/8/3k4/8/8/7Q/4K3 w - - 0 1 ")) == BitbaseResults::WIN);
+		REQUIRE(bitbases.probe(Game("8/8/8/3k4/8/8/7Q/4K3 b - - 0 1 ")) == BitbaseResults::LOSS);
+		REQUIRE(bitbases.probe(Game("8/8/8/8/8/1k6/1q6/K7 w - - 0 1 ")) == BitbaseResults::LOSS);
+		REQUIRE(bitbases.probe(Game("4k3/8/8/8/8/8/8/RR2K3 w - - 0 1 ")) == BitbaseResults::UNKNOWN);
+		REQUIRE(bitbases.probe(Game("4k3/8/8/8/8/8/4r3/4K3 w - - 0 1 ")) == BitbaseResults::DRAW);
+		REQUIRE(bitbases.probe(Game("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1 ")) == BitbaseResults::DRAW);
+	}
+
+	SECTION("King and pawn") {
+		REQUIRE(bitbases.probe(Game("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1 ")) == BitbaseResults::LOSS);
+		REQUIRE(bitbases.probe(Game("k7/8/K7/P7/8/8/8/8 w - - 0 1 ")) == BitbaseResults::DRAW);
+		REQUIRE(bitbases.probe(Game("k7/8/8/7P/8/8/8/K7 b - - 0 1 ")) == BitbaseResults::LOSS);
+		REQUIRE(bitbases.probe(Game("K7/8/8/8/7p/8/8/k7 w - - 0 1 ")) == BitbaseResults::LOSS);
+		REQUIRE(bitbases.probe(Game("8/8/8/8/8/k7/p7/K7 w - - 0 1 ")) == BitbaseResults::DRAW);
+
+		Game promoting("8/4P3/8/8/8/k7/8/K7 w - - 0 1 ");
+		REQUIRE(promoting.move({.from = {.file = Files::E, .rank = 7}, .to = {.file = Files::E, .rank = 8}}));
+		REQUIRE(bitbases.probe(promoting) == BitbaseResults::UNKNOWN);
+	}
+
+	SECTION("Only the material a table was built for is probed") {
+		// every position won, so anything wrongly sent to this table shows up
+		writeBitbase(directory + "/KBNK.bb", Endgames::KBNK, vector<uint8_t>((bitbaseSize(Endgames::KBNK) + 7) / 8, 0xFF));
+		Bitbases withBishopKnight(directory);
+
+		REQUIRE(withBishopKnight.probe(Game("4k3/8/8/8/8/8/8/1N2KB2 w - - 0 1 ")) == BitbaseResults::WIN);
+		REQUIRE(withBishopKnight.probe(Game("4k3/8/8/8/8/8/4P3/R3K3 w - - 0 1 ")) == BitbaseResults::UNKNOWN);
+		REQUIRE(withBishopKnight.probe(Game("4k3/8/8/8/8/8/8/1B2KB2 w - - 0 1 ")) == BitbaseResults::UNKNOWN);
+		REQUIRE(withBishopKnight.probe(Game("4k3/8/8/8/8/8/8/1N2KN2 w - - 0 1 ")) == BitbaseResults::UNKNOWN);
+	}
+
+	filesystem::remove_all(directory);
+}
+
+TEST_CASE("Arena") {
+	Arena arena(256);
+
+	SECTION("Aligns and rewinds") {
+		char* c = arena.allocate<char>(3);
+		uint64_t* n = arena.allocate<uint64_t>(2);
+		REQUIRE((uintptr_t)n % alignof(uint64_t) == 0);
+		REQUIRE((char*)n >= c + 3);
+
+		Arena::Mark mark = arena.mark();
+		uint64_t* first = arena.allocate<uint64_t>();
+		{
+			ArenaScope scope(arena);
+			arena.allocate<uint64_t>(4);
+		}
+		arena.rewind(mark);
+		REQUIRE(arena.allocate<uint64_t>() == first);
+	}
+
+	SECTION("Grows past a block and reuses it after a reset") {
+		char* small = arena.allocate<char>(16);
+		arena.allocate<char>(1000);	 // bigger than a block
+		arena.allocate<char>(200);
+		size_t capacity = arena.capacity();
+		REQUIRE(capacity >= 1216);
+
+		arena.reset();
+		REQUIRE(arena.allocate<char>(16) == small);
+		arena.allocate<char>(1000);
+		arena.allocate<char>(200);
+		REQUIRE(arena.capacity() == capacity);
+	}
+}
+
+TEST_CASE("Search") {
+	Searcher searcher(1 << 12);
+
+	SECTION("Finds mate in one") {
+		SearchResult result = searcher.search(Game("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1"), {.depth = 3});
+
+		REQUIRE(result.move.from == Position{.file = Files::A, .rank = 1});
+		REQUIRE(result.move.to == Position{.file = Files::A, .rank = 8});
+		REQUIRE(result.score == MATE - 1);
+		REQUIRE(result.pv.size() == 1);
+	}
+
+	SECTION("Principal variation starts with the move and is playable") {
+		Game game;
+		SearchResult result = searcher.search(game, {.depth = 4});
+
+		REQUIRE(!result.pv.empty());
+		REQUIRE(result.pv.size() <= 4);
+		REQUIRE(result.pv[0].from == result.move.from);
+		REQUIRE(result.pv[0].to == result.move.to);
+		for (const Move& move : result.pv) {
+			REQUIRE_NOTHROW(game = game.branch(move));
+		}
+		REQUIRE(searcher.arenaCapacity() > 0);
+	}
+
+	SECTION("Iteration statistics and trace") {
+		searcher.setTrace(50);
+		SearchResult result = searcher.search(Game(), {.depth = 3});
+
+		uint64_t nodes = 0;
+		for (uint64_t count : result.stats.nodesByPly) {
+			nodes += count;
+		}
+		REQUIRE(nodes == result.stats.nodes);
+		REQUIRE(result.stats.seldepth >= 3);
+		REQUIRE(result.stats.nodesByPly.size() == result.stats.seldepth + 1);
+		REQUIRE(result.stats.branchingFactor > 1);
+		REQUIRE(result.stats.failHighsFirst <= result.stats.failHighs);
+		REQUIRE(toJSON(result).rfind("{\"depth\":3,", 0) == 0);
+
+		REQUIRE(searcher.trace().size() == 50);
+		REQUIRE(searcher.traceTruncated());
+		REQUIRE(searcher.trace()[0].depth == 1);
+		REQUIRE(searcher.trace()[0].ply == 1);
+	}
+
+	SECTION("Takes a hanging queen and promotes to a queen") {
+		SearchResult result = searcher.search(Game("4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1"), {.depth = 2});
+		REQUIRE(result.move.to == Position{.file = Files::D, .rank = 5});
+
+		result = searcher.search(Game("8/P6k/8/8/8/8/8/K7 w - - 0 1"), {.depth = 1});
+		REQUIRE(result.move.to == Position{.file = Files::A, .rank = 8});
+		REQUIRE(result.promotion == PieceTypes::QUEEN);
+	}
+
+	SECTION("Limits still finish depth 1") {
+		atomic<bool> stop = true;
+		SearchResult result = searcher.search(Game(), {.depth = 5}, &stop);
+		REQUIRE(result.depth == 1);
+
+		result = searcher.search(Game(), {.nodes = 100});
+		REQUIRE(result.depth >= 1);
+		REQUIRE(result.depth < 5);
+	}
+
+	REQUIRE_THROWS(searcher.search(Game("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"), {.depth = 1}));
+}
+
+TEST_CASE("Monte Carlo tree search") {
+	MCTS mcts(1 << 16);
+
+	SECTION("Finds mate in one") {
+		MCTSResult result = mcts.search(Game("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1"), {.nodes = 2000});
+
+		REQUIRE(result.move.from == Position{.file = Files::A, .rank = 1});
+		REQUIRE(result.move.to == Position{.file = Files::A, .rank = 8});
+		REQUIRE(result.score > 1000);
+		REQUIRE(result.distribution.size() == 20);
+	}
+
+	SECTION("Threads share the tree") {
+		MCTSResult result = mcts.search(Game("4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1"), {.nodes = 4000}, 4);
+		REQUIRE(result.move.to == Position{.file = Files::D, .rank = 5});
+		REQUIRE(result.playouts >= 4000);
+
+		uint64_t visits = 0;
+		float priors = 0;
+		for (const MoveVisits& move : result.distribution) {
+			visits += move.visits;
+			priors += move.prior;
+		}
+		REQUIRE(visits < result.playouts);
+		REQUIRE(visits + 4 >= result.playouts);  // every thread may have scored the root itself on its first playout
+		REQUIRE(priors == Approx(1));
+		REQUIRE(result.distribution[0].visits >= result.distribution.back().visits);
+	}
+
+	SECTION("Stops when the pool is full") {
+		MCTS small(256);
+		MCTSResult result = small.search(Game(), {});
+
+		REQUIRE(small.treeSize() <= 256);
+		REQUIRE(result.distribution.size() == 20);
+		REQUIRE(result.playouts > 0);
+	}
+
+	REQUIRE_THROWS(mcts.search(Game("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"), {.nodes = 10}));
+}
+
+TEST_CASE("Match statistics") {
+	SECTION("Elo") {
+		EloEstimate even = estimateElo(10, 20, 10);
+		REQUIRE(even.elo == Approx(0));
+		REQUIRE(even.margin > 0);
+
+		EloEstimate ahead = estimateElo(60, 20, 20);
+		REQUIRE(ahead.elo == Approx(147.2).epsilon(0.01));
+		REQUIRE(estimateElo(600, 200, 200).margin < ahead.margin);
+	}
+
+	SECTION("SPRT") {
+		SPRT sprt(0, 10);
+
+		REQUIRE(sprt.lowerBound() == Approx(-2.944).epsilon(0.001));
+		REQUIRE(sprt.upperBound() == Approx(2.944).epsilon(0.001));
+		REQUIRE(sprt.test(10, 10, 10) == SPRTResults::UNDECIDED);
+		REQUIRE(sprt.test(600, 400, 400) == SPRTResults::ACCEPT_H1);
+		REQUIRE(sprt.test(400, 400, 600) == SPRTResults::ACCEPT_H0);
+		REQUIRE(sprt.llr(0, 0, 0) == 0);
+	}
+}
+
+TEST_CASE("Bounded queue") {
+	BoundedQueue<uint64_t> queue(5);
+	REQUIRE(queue.capacity() == 8);
+
+	SECTION("Fills up and drains in order") {
+		uint64_t value;
+
+		REQUIRE(!queue.tryPop(value));
+		for (uint64_t i = 0; i < 8; i++) {
+			REQUIRE(queue.tryPush(i));
+		}
+		REQUIRE(!queue.tryPush(8));
+
+		for (uint64_t i = 0; i < 8; i++) {
+			REQUIRE(queue.tryPop(value));
+			REQUIRE(value == i);
+		}
+		REQUIRE(!queue.tryPop(value));
+	}
+
+	SECTION("Many producers, one consumer") {
+		const uint producers = 4;
+		const uint64_t perProducer = 20000;
+		vector<thread> threads;
+
+		for (uint p = 0; p < producers; p++) {
+			threads.emplace_back([&, p]() {
+				for (uint64_t i = 0; i < perProducer; i++) {
+					while (!queue.tryPush(p * perProducer + i)) {
+						this_thread::yield();
+					}
+				}
+			});
+		}
+
+		// every value arrives exactly once, and each producer's values arrive in the order they were pushed
+		vector<uint64_t> next(producers, 0);
+		uint64_t value, received = 0;
+		bool ordered = true;
+		while (received < producers * perProducer) {
+			if (!queue.tryPop(value)) {
+				this_thread::yield();
+				continue;
+			}
+
+			uint p = value / perProducer;
+			ordered &= value % perProducer == next[p]++;
+			received++;
+		}
+
+		for (thread& t : threads) {
+			t.join();
+		}
+
+		REQUIRE(ordered);
+		REQUIRE(!queue.tryPop(value));
+	}
+}
+
+TEST_CASE("Batch evaluation") {
+	vector<Game> games = {Game(), Game("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"),
+						  Game("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"), Game("4k3/8/8/8/Pp6/8/8/4K3 b - a3 0 1"),
+						  Game("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1"), Game("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1")};
+	vector<uint16_t> expectedCounts = {20, 48, 14, 7, 26, 0};
+
+	PositionBatch batch, packed;
+	for (const Game& game : games) {
+		batch.add(game);
+		packed.add(packPosition(game));
+	}
+	REQUIRE(batch.size() == games.size());
+
+	vector<int> scores(batch.size()), mobility(batch.size());
+	vector<uint16_t> counts(batch.size()), packedCounts(batch.size());
+	evaluateBatch(batch, scores.data());
+	mobilityBatch(batch, mobility.data());
+	countMovesBatch(batch, counts.data());
+	countMovesBatch(packed, packedCounts.data());
+
+	for (size_t i = 0; i < games.size(); i++) {
+		REQUIRE(scores[i] == evaluate(games[i]));
+		REQUIRE(counts[i] == expectedCounts[i]);
+		REQUIRE(counts[i] == games[i].getAvailableMoves().size());
+		REQUIRE(packedCounts[i] == counts[i]);
+	}
+
+	// the start is symmetric; with black to move, white's queen counts against the mover
+	REQUIRE(mobility[0] == 0);
+	REQUIRE(mobility[5] < 0);
+
+	batch.clear();
+	REQUIRE(batch.size() == 0);
 }
\ No newline at end of file